@@ -28,89 +28,242 @@
 
 #include "ethernet-serversocket.h"
 
+#include <string.h>
+
+#define ETHERNETSERVERSOCKET_CHECK(condition, name) \
+    typedef char EthernetServerSocket_check_##name[(condition) ? 1 : -1]
+
+#define ETHERNETSERVERSOCKET_CHECK_SERVER(name, clients, rx, tx, ...)      \
+    ETHERNETSERVERSOCKET_CHECK((clients) > 0, name##_clients);              \
+    ETHERNETSERVERSOCKET_CHECK(((rx) >= 2) && ((rx) <= 32768) &&            \
+                               (((rx) & ((rx) - 1)) == 0),                  \
+                               name##_rx_buffer_power_of_two);              \
+    ETHERNETSERVERSOCKET_CHECK(((tx) == 0) || (((tx) >= 2) &&               \
+                               ((tx) <= 32768) &&                           \
+                               (((tx) & ((tx) - 1)) == 0)),                 \
+                               name##_tx_buffer_power_of_two);
+
+#define ETHERNETSERVERSOCKET_BUFFERS(name, clients, rx, tx, ...)            \
+    static uint8_t EthernetServerSocket_rxBuffer_##name[(clients) * (rx)];  \
+    static uint8_t EthernetServerSocket_txBuffer_##name[(tx) ? ((clients) * (tx)) : 1];
+
+#define ETHERNETSERVERSOCKET_CONFIG(name, clients, rx, tx, ...)             \
+    {                                                                       \
+        .firstClient  = ETHERNETSERVERSOCKET_FIRST_##name,                  \
+        .maxClients   = (clients),                                          \
+        .bufferMask   = (rx) - 1,                                           \
+        .rxBuffer     = EthernetServerSocket_rxBuffer_##name,               \
+        .txBufferMask = (tx) ? ((tx) - 1) : 0,                              \
+        .txBuffer     = EthernetServerSocket_txBuffer_##name,               \
+        __VA_ARGS__                                                         \
+    },
+
+ETHERNET_SERVER_TABLE(ETHERNETSERVERSOCKET_CHECK_SERVER)
+ETHERNETSERVERSOCKET_CHECK(ETHERNETSERVERSOCKET_CLIENTS <= 255, total_clients);
+
+ETHERNET_SERVER_TABLE(ETHERNETSERVERSOCKET_BUFFERS)
+
+const EthernetServerSocket_Config EthernetServerSocket_config[ETHERNETSERVERSOCKET_SERVERS] =
+{
+    ETHERNET_SERVER_TABLE(ETHERNETSERVERSOCKET_CONFIG)
+};
+
 typedef struct _EthernetServerSocket_Device
 {
     uint8_t number;
 
-    uint16_t port;
+    const EthernetServerSocket_Config* config;
 
-    struct tcp_pcb *pcb;
+    EthernetSocket_Pcb *pcb;
+
+    void* tls;            /**< TLS configuration, NULL for plain TCP */
 
     uint8_t connectedClients;            /**< The number of connected clients */
 
     EthernetSocket_Status status;
 } EthernetServerSocket_Device;
 
-typedef struct _EthernetServerSocket_Client
-{
-    struct tcp_pcb *clientpcb;
+static EthernetServerSocket_Device EthernetServerSocket_socket[ETHERNETSERVERSOCKET_SERVERS];
 
-    uint8_t rxBuffer[ETHERNET_MAX_SOCKET_BUFFER+1];
-    uint16_t rxBufferTail;
-    uint16_t rxBufferHead;
+EthernetServerSocket_Client EthernetServerSocket_listenClients[ETHERNETSERVERSOCKET_CLIENTS];
+EthernetServerSocket_ClientData EthernetServerSocket_clientData[ETHERNETSERVERSOCKET_CLIENTS];
 
-    err_t tcpError;                 /**< TCP error from error handle function */
+static uint8_t EthernetServerSocket_txNext = 0;    /**< Next client to send */
+static bool EthernetServerSocket_txRunning = FALSE;
 
-    EthernetSocket_Status status;
+static void EthernetServerSocket_releaseClient (EthernetServerSocket_Client* client)
+{
+    EthernetServerSocket_ClientData* data = ETHERNETSERVERSOCKET_DATA(client);
 
-    EthernetServerSocket_Device* server;
-} EthernetServerSocket_Client;
+    ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_CLOSE,client,0);
 
-static EthernetServerSocket_Device EthernetServerSocket_socket[ETHERNET_MAX_SOCKET_SERVER];
+    if (data->rxPending != NULL)
+    {
+        pbuf_free(data->rxPending);
+        data->rxPending = NULL;
+    }
 
-static EthernetServerSocket_Client EthernetServerSocket_listenClients[ETHERNET_MAX_SOCKET_SERVER*ETHERNET_MAX_LISTEN_CLIENT];
+    client->status = ETHERNETSOCKET_STATUS_DISCONNECTED;
+    client->flags &= ~ETHERNETSERVERSOCKET_FLAG_CLOSING;
+    // All the handles of this connection become stale
+    if (++client->generation == 0)
+        client->generation = 1;
+    EthernetServerSocket_socket[client->server].connectedClients--;
+}
+
+/*
+ * Close the connection with the client and free its slot. When lwIP has
+ * no memory to close, the connection is aborted and ERR_ABRT returned,
+ * that must be returned by the lwIP callbacks.
+ * When the transmit buffer isn't empty the client is only marked as
+ * closing: its handles become stale, and the connection is closed by
+ * EthernetServerSocket_txSchedule() after the last byte.
+ */
+static err_t EthernetServerSocket_closeClient (EthernetServerSocket_Client* client)
+{
+    if ((client->txBufferTail != client->txBufferHead) &&
+        ((client->flags & ETHERNETSERVERSOCKET_FLAG_CLOSING) == 0))
+    {
+        EthernetServerSocket_ClientData* data = ETHERNETSERVERSOCKET_DATA(client);
+        uint16_t mask = EthernetServerSocket_config[client->server].bufferMask;
+
+        client->flags |= ETHERNETSERVERSOCKET_FLAG_CLOSING;
+        if (++client->generation == 0)
+            client->generation = 1;
+
+        // Nobody reads anymore: open the window for the bytes not read
+        EthernetSocket_tcpRecved(client->clientpcb,
+                (client->rxBufferTail - client->rxBufferHead) & mask);
+        client->rxBufferHead = client->rxBufferTail;
+        if (data->rxPending != NULL)
+        {
+            EthernetSocket_tcpRecved(client->clientpcb,data->rxPending->tot_len);
+            pbuf_free(data->rxPending);
+            data->rxPending = NULL;
+        }
+        return ERR_OK;
+    }
+
+    // Close the connection with the client
+    EthernetSocket_Pcb * pcb = client->clientpcb;
+    EthernetSocket_tcpArg(pcb,NULL);
+    EthernetSocket_tcpSent(pcb,NULL);
+    EthernetSocket_tcpRecv(pcb,NULL);
+    EthernetSocket_tcpErr(pcb,NULL);
+    if (EthernetServerSocket_config[client->server].txBufferMask != 0)
+        EthernetSocket_tcpPoll(pcb,NULL,0);
+
+    err_t error = EthernetSocket_tcpClose(pcb);
+    if (error != ERR_OK)
+    {
+        EthernetSocket_tcpAbort(pcb);
+        error = ERR_ABRT;
+    }
+    client->clientpcb = NULL;
+    EthernetServerSocket_releaseClient(client);
+    return error;
+}
 
 static EthernetSocket_CurrentTick EthernetServerSocket_currentTick;
 static EthernetSocket_Delay EthernetServerSocket_delay;
+static EthernetSocket_Idle EthernetServerSocket_idle;
+static EthernetSocket_Wake EthernetServerSocket_wake;
+
+/* Set by the lwIP callbacks, cleared by EthernetServerSocket_wait() */
+static volatile bool EthernetServerSocket_event = FALSE;
+
+/*
+ * Set the event, and wake who waits for it out of
+ * EthernetServerSocket_wait() (for example another thread).
+ */
+static void EthernetServerSocket_raise (void)
+{
+    EthernetServerSocket_event = TRUE;
+    if (EthernetServerSocket_wake != NULL)
+        EthernetServerSocket_wake();
+}
 
 static uint32_t EthernetServerSocket_timeout = 0;
 
 static bool EthernetServerSocket_isInit = FALSE;
 
+/*
+ * Store into the receive buffer the pending bytes that fit. The bytes are
+ * acknowledged when they are read, so lwIP can't give more than the
+ * receive window, whatever the size of the buffer.
+ */
+void EthernetServerSocket_rxRefill (EthernetServerSocket_Client* client)
+{
+    EthernetServerSocket_ClientData* data = ETHERNETSERVERSOCKET_DATA(client);
+    uint16_t mask = EthernetServerSocket_config[client->server].bufferMask;
+    uint16_t length = mask - ((client->rxBufferTail - client->rxBufferHead) & mask);
+
+    if (length > data->rxPending->tot_len)
+        length = data->rxPending->tot_len;
+    if (length == 0)
+        return;
+
+    // Up to the end of the buffer, then from its start
+    uint16_t first = (mask + 1) - client->rxBufferTail;
+    if (first > length)
+        first = length;
+    pbuf_copy_partial(data->rxPending,&data->rxBuffer[client->rxBufferTail],first,0);
+    pbuf_copy_partial(data->rxPending,data->rxBuffer,length - first,first);
+    client->rxBufferTail = (client->rxBufferTail + length) & mask;
+    ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_RECEIVE,client,length);
+
+    // Free the pbufs already stored
+    data->rxPending = pbuf_free_header(data->rxPending,length);
+}
+
 err_t EthernetServerSocket_receiveHandle (void *arg,
-                                          struct tcp_pcb *pcb,
+                                          EthernetSocket_Pcb *pcb,
                                           struct pbuf *p,
                                           err_t err)
 {
-    uint16_t plen;
-    uint8_t count = 0;
-    uint8_t* payload;
     EthernetServerSocket_Client *dev = (EthernetServerSocket_Client *)arg;
+    EthernetServerSocket_ClientData* data = ETHERNETSERVERSOCKET_DATA(dev);
 
-    if ((err == ERR_OK) && (p != NULL))
-    {
-        // Get buffer dimension
-        plen = p->len;
-        // Save payload pointer
-        payload = (uint8_t *)p->payload;
+    // New data or closed connection
+    EthernetServerSocket_raise();
 
-        // Store all byte received into socket buffer
-        for (uint16_t i = 0; i < plen; i++)
+    // Nobody reads anymore, while the last bytes are sent
+    if ((dev->flags & ETHERNETSERVERSOCKET_FLAG_CLOSING) != 0)
+    {
+        if (p != NULL)
         {
-            if ((dev->rxBufferTail + 1) != dev->rxBufferHead)
-            {
-                dev->rxBuffer[dev->rxBufferTail] = *payload;
-                dev->rxBufferTail++;
-                dev->rxBufferTail &= ETHERNET_MAX_SOCKET_BUFFER;
-                payload++;
-            }
-            else
-            {
-                // FIXME: error!
-            }
+            EthernetSocket_tcpRecved(pcb,p->tot_len);
+            pbuf_free(p);
         }
-        // Acknowledge of data processed
-        tcp_recved(pcb,plen);
-        count = pbuf_free(p);
+        return ERR_OK;
+    }
+
+    if ((err == ERR_OK) && (p != NULL))
+    {
+        // The bytes that don't fit wait into the pbufs, after the others
+        // still waiting, until they are read
+        if (data->rxPending != NULL)
+            pbuf_cat(data->rxPending,p);
+        else
+            data->rxPending = p;
+        EthernetServerSocket_rxRefill(dev);
+        return ERR_OK;
+    }
+    else if (p == NULL)
+    {
+        // The client closed its side: the data not read yet are still
+        // readable, the connection is closed when they are over
+        if (dev->rxBufferTail == dev->rxBufferHead)
+            return EthernetServerSocket_closeClient(dev);
+
+        dev->flags |= ETHERNETSERVERSOCKET_FLAG_REMOTE_CLOSED;
         return ERR_OK;
     }
     else
     {
-        // FIXME!
-        tcp_arg(pcb,NULL);
-        tcp_sent(pcb,NULL);
-        tcp_recv(pcb,NULL);
-        return ERR_BUF;
+        // Data with error: drop it
+        pbuf_free(p);
+        return ERR_OK;
     }
 }
 
@@ -118,16 +271,185 @@ void EthernetServerSocket_errorHandle (void *arg,
                                       err_t err)
 {
     EthernetServerSocket_Client *dev = (EthernetServerSocket_Client *)arg;
-    dev->server->status = ETHERNETSOCKET_STATUS_ERROR;
-    // FIXME
+
+    if (dev == NULL)
+        return;
+
     // Save error type!
-    dev->tcpError = err;
+    ETHERNETSERVERSOCKET_DATA(dev)->tcpError = err;
+    EthernetServerSocket_raise();
+    ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_ERROR,dev,err);
+
+    // The pcb was just freed by lwIP (reset, keepalive timeout...):
+    // free the slot for a new client
+    dev->clientpcb = NULL;
+    EthernetServerSocket_releaseClient(dev);
+}
+
+/*
+ * Call the backpressure callback when the waiting bytes cross txHighWater
+ * going up, or half of it going down.
+ */
+static void EthernetServerSocket_txWater (EthernetServerSocket_Client* dev)
+{
+    const EthernetServerSocket_Config* config = &EthernetServerSocket_config[dev->server];
 
-    // TODO:
+    if ((config->txWater == NULL) || (config->txHighWater == 0) ||
+        ((dev->flags & ETHERNETSERVERSOCKET_FLAG_CLOSING) != 0))
+        return;
+
+    uint16_t waiting = (dev->txBufferTail - dev->txBufferHead) & config->txBufferMask;
+    uint8_t slot = dev - EthernetServerSocket_listenClients;
+
+    if (((dev->flags & ETHERNETSERVERSOCKET_FLAG_TX_HIGH) == 0) &&
+        (waiting > config->txHighWater))
+    {
+        dev->flags |= ETHERNETSERVERSOCKET_FLAG_TX_HIGH;
+        config->txWater(ETHERNETSERVERSOCKET_HANDLE(slot,dev->generation),TRUE);
+    }
+    else if (((dev->flags & ETHERNETSERVERSOCKET_FLAG_TX_HIGH) != 0) &&
+             (waiting <= (config->txHighWater / 2)))
+    {
+        dev->flags &= ~ETHERNETSERVERSOCKET_FLAG_TX_HIGH;
+        config->txWater(ETHERNETSERVERSOCKET_HANDLE(slot,dev->generation),FALSE);
+    }
+}
+
+/*
+ * Send the transmit buffers of the clients. With the round robin and
+ * deficit policies every client sends in turn at most its quantum, the
+ * others send all they can; until lwIP has no more space or
+ * ETHERNET_SOCKET_TX_BUDGET bytes are sent.
+ * The closing clients are closed when their buffer is empty: it returns
+ * ERR_ABRT when the connection of pcb was aborted, ERR_OK otherwise.
+ */
+static err_t EthernetServerSocket_txSchedule (EthernetSocket_Pcb* pcb)
+{
+    uint32_t budget = ETHERNET_SOCKET_TX_BUDGET;
+    bool progress = TRUE;
+    err_t result = ERR_OK;
+
+    // Written by the txWater callback: the running loop sends it
+    if (EthernetServerSocket_txRunning == TRUE)
+        return ERR_OK;
+    EthernetServerSocket_txRunning = TRUE;
+
+    while ((budget > 0) && (progress == TRUE))
+    {
+        progress = FALSE;
+
+        for (uint8_t i = 0; (i < ETHERNETSERVERSOCKET_CLIENTS) && (budget > 0); ++i)
+        {
+            uint8_t slot = (EthernetServerSocket_txNext + i) % ETHERNETSERVERSOCKET_CLIENTS;
+            EthernetServerSocket_Client* dev = &EthernetServerSocket_listenClients[slot];
+
+            if ((dev->status != ETHERNETSOCKET_STATUS_CONNECTED) ||
+                (dev->txBufferTail == dev->txBufferHead))
+                continue;
+
+            const EthernetServerSocket_Config* config = &EthernetServerSocket_config[dev->server];
+            EthernetServerSocket_ClientData* data = &EthernetServerSocket_clientData[slot];
+            uint16_t quantum = (config->quantum != 0) ? config->quantum : TCP_MSS;
+
+            // Only the contiguous bytes, the others at the next turn
+            uint16_t length;
+            if (dev->txBufferTail > dev->txBufferHead)
+                length = dev->txBufferTail - dev->txBufferHead;
+            else
+                length = config->txBufferMask + 1 - dev->txBufferHead;
+
+            // A client lwIP can't take bytes from doesn't earn its quantum
+            if (EthernetSocket_tcpSndbuf(dev->clientpcb) == 0)
+                continue;
+
+            uint16_t turn = quantum;
+            if (config->txPolicy < ETHERNETSERVERSOCKET_TXPOLICY_ROUND_ROBIN)
+            {
+                turn = length;
+            }
+            else if (config->txPolicy == ETHERNETSERVERSOCKET_TXPOLICY_DEFICIT)
+            {
+                if (data->deficit <= (0xFFFF - quantum))
+                    data->deficit += quantum;
+                turn = data->deficit;
+            }
+
+            if (length > turn) length = turn;
+            if (length > budget) length = budget;
+            if (length > EthernetSocket_tcpSndbuf(dev->clientpcb)) length = EthernetSocket_tcpSndbuf(dev->clientpcb);
+            if (length == 0)
+                continue;
+
+            if (EthernetSocket_tcpWrite(dev->clientpcb,
+                          &data->txBuffer[dev->txBufferHead],
+                          length,
+                          TCP_WRITE_FLAG_COPY) != ERR_OK)
+                continue;
+
+            // Deferred data are sent by lwIP on next ack or timer
+            if (config->txPolicy != ETHERNETSERVERSOCKET_TXPOLICY_DEFERRED)
+            {
+                EthernetSocket_tcpOutput(dev->clientpcb);
+                ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_OUTPUT,dev,length);
+            }
+            dev->txBufferHead = (dev->txBufferHead + length) & config->txBufferMask;
+            budget -= length;
+            progress = TRUE;
+
+            if (config->txPolicy == ETHERNETSERVERSOCKET_TXPOLICY_DEFICIT)
+            {
+                // An empty client doesn't save its quantum
+                if (dev->txBufferTail == dev->txBufferHead)
+                    data->deficit = 0;
+                else
+                    data->deficit -= length;
+            }
+
+            // Next scheduling starts after the last client served
+            EthernetServerSocket_txNext = (slot + 1) % ETHERNETSERVERSOCKET_CLIENTS;
+
+            // Last, the callback can write again
+            EthernetServerSocket_txWater(dev);
+
+            // All sent, the connection can be closed
+            if (((dev->flags & ETHERNETSERVERSOCKET_FLAG_CLOSING) != 0) &&
+                (dev->txBufferTail == dev->txBufferHead))
+            {
+                EthernetSocket_Pcb* closed = dev->clientpcb;
+                if ((EthernetServerSocket_closeClient(dev) == ERR_ABRT) && (closed == pcb))
+                    result = ERR_ABRT;
+            }
+        }
+    }
+    EthernetServerSocket_txRunning = FALSE;
+    return result;
+}
+
+err_t EthernetServerSocket_sentHandle (void *arg,
+                                       EthernetSocket_Pcb *pcb,
+                                       uint16_t len)
+{
+    EthernetServerSocket_Client *dev = (EthernetServerSocket_Client *)arg;
+
+    // The client can write again
+    EthernetServerSocket_raise();
+
+    // Space is free in lwIP, fill it with the waiting clients
+    if (EthernetServerSocket_config[dev->server].txBufferMask == 0)
+        return ERR_OK;
+    return EthernetServerSocket_txSchedule(pcb);
+}
+
+err_t EthernetServerSocket_pollHandle (void *arg,
+                                       EthernetSocket_Pcb *pcb)
+{
+    // Retry the data refused when lwIP had no memory: without data
+    // waiting for an ack, the sent callback never comes
+    return EthernetServerSocket_txSchedule(pcb);
 }
 
 err_t EthernetServerSocket_connectionHandle (void *arg,
-                                             struct tcp_pcb *pcb,
+                                             EthernetSocket_Pcb *pcb,
                                              err_t err)
 {
     // Change the status of the socket
@@ -136,43 +458,90 @@ err_t EthernetServerSocket_connectionHandle (void *arg,
     // Set the status of server to "connect"
     dev->status = ETHERNETSOCKET_STATUS_CONNECTED;
 
-    if (dev->connectedClients < ETHERNET_MAX_LISTEN_CLIENT)
+    if (dev->connectedClients < dev->config->maxClients)
     {
         uint8_t currentClient = 0;
-        for (uint8_t i = 0; i < ETHERNET_MAX_LISTEN_CLIENT; i++)
+        for (uint8_t i = 0; i < dev->config->maxClients; i++)
         {
-            currentClient = (dev->number * ETHERNET_MAX_LISTEN_CLIENT) + i;
+            currentClient = dev->config->firstClient + i;
             if (EthernetServerSocket_listenClients[currentClient].status !=
                     ETHERNETSOCKET_STATUS_CONNECTED)
                 break;
         }
 
         // Save server pointer
-        EthernetServerSocket_listenClients[currentClient].server = dev;
+        EthernetServerSocket_listenClients[currentClient].server = dev->number;
         // Save current PCB
         EthernetServerSocket_listenClients[currentClient].clientpcb = pcb;
+        // Clear data of the previous connection
+        EthernetServerSocket_listenClients[currentClient].rxBufferHead = 0;
+        EthernetServerSocket_listenClients[currentClient].rxBufferTail = 0;
+        EthernetServerSocket_listenClients[currentClient].txBufferHead = 0;
+        EthernetServerSocket_listenClients[currentClient].txBufferTail = 0;
+        EthernetServerSocket_clientData[currentClient].deficit = 0;
+        EthernetServerSocket_listenClients[currentClient].flags = 0;
         // Save into PCB the current client pointer
-        tcp_arg(EthernetServerSocket_listenClients[currentClient].clientpcb,
+        EthernetSocket_tcpArg(EthernetServerSocket_listenClients[currentClient].clientpcb,
                 &EthernetServerSocket_listenClients[currentClient]);
 
-        // Save status
+        // Save status and start a new connection generation
         EthernetServerSocket_listenClients[currentClient].status =
                 ETHERNETSOCKET_STATUS_CONNECTED;
+        if (++EthernetServerSocket_listenClients[currentClient].generation == 0)
+            EthernetServerSocket_listenClients[currentClient].generation = 1;
 
         // Setup callback
         // Connect all handle!
-        tcp_recv(EthernetServerSocket_listenClients[currentClient].clientpcb,
+        EthernetSocket_tcpRecv(EthernetServerSocket_listenClients[currentClient].clientpcb,
                  EthernetServerSocket_receiveHandle);
-        tcp_err(EthernetServerSocket_listenClients[currentClient].clientpcb,
+        EthernetSocket_tcpErr(EthernetServerSocket_listenClients[currentClient].clientpcb,
                 EthernetServerSocket_errorHandle);
+        // Find dead clients, that never close the connection
+#if LWIP_TCP_KEEPALIVE
+        if (dev->config->keepIdle != 0)
+        {
+            EthernetSocket_tcpKeepalive(EthernetServerSocket_listenClients[currentClient].clientpcb,
+                    dev->config->keepIdle,
+                    (dev->config->keepInterval != 0) ?
+                            dev->config->keepInterval : ETHERNET_SOCKET_KEEPALIVE_INTERVAL,
+                    (dev->config->keepCount != 0) ?
+                            dev->config->keepCount : ETHERNET_SOCKET_KEEPALIVE_COUNT);
+        }
+#elif ETHERNET_SOCKET_KEEPALIVE
+        if (dev->config->keepIdle != 0)
+        {
+            EthernetSocket_tcpKeepalive(EthernetServerSocket_listenClients[currentClient].clientpcb,
+                    dev->config->keepIdle,0,0);
+        }
+#endif
+        EthernetSocket_tcpSent(EthernetServerSocket_listenClients[currentClient].clientpcb,
+                 EthernetServerSocket_sentHandle);
+        if (dev->config->txBufferMask != 0)
+        {
+            EthernetSocket_tcpPoll(EthernetServerSocket_listenClients[currentClient].clientpcb,
+                     EthernetServerSocket_pollHandle,
+                     ETHERNET_SOCKET_TX_POLL);
+        }
 
         // Update connected clients
         dev->connectedClients++;
+        EthernetServerSocket_raise();
+        ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_ACCEPT,
+                &EthernetServerSocket_listenClients[currentClient],0);
+
+        if (dev->config->accept != NULL)
+        {
+            dev->config->accept(dev->number,
+                    currentClient - dev->config->firstClient,
+                    ETHERNETSERVERSOCKET_HANDLE(currentClient,
+                            EthernetServerSocket_listenClients[currentClient].generation));
+        }
         return ERR_OK;
     }
     else
     {
         // Too much clients
+        ETHERNETSOCKET_TRACE(ETHERNETSOCKET_TRACE_REJECT,dev->number,0,ERR_MEM);
         return ERR_MEM;
     }
 }
@@ -184,9 +553,14 @@ void EthernetServerSocket_init (EthernetSocket_Config* config)
 
     // Save callback for current tick informations
     EthernetServerSocket_currentTick = config->currentTick;
+    ETHERNETSOCKET_TRACE_INIT(config->currentTick);
 
     // Save callback for blocking delay function
     EthernetServerSocket_delay = config->delay;
+    // Save callback for sleep while waiting events
+    EthernetServerSocket_idle = config->idle;
+    // Save callback to wake who waits events
+    EthernetServerSocket_wake = config->wake;
 
     // Save timeout information
     if (config->timeout == 0)
@@ -194,31 +568,46 @@ void EthernetServerSocket_init (EthernetSocket_Config* config)
     else
         EthernetServerSocket_timeout = config->timeout;
 
-    for (uint8_t i = 0; i < ETHERNET_MAX_SOCKET_SERVER; ++i)
+    for (uint8_t i = 0; i < ETHERNETSERVERSOCKET_SERVERS; ++i)
     {
+        const EthernetServerSocket_Config* config = &EthernetServerSocket_config[i];
+
         EthernetServerSocket_socket[i].number = i;
+        EthernetServerSocket_socket[i].config = config;
         EthernetServerSocket_socket[i].status = ETHERNETSOCKET_STATUS_INIT;
-    }
-
-    for (uint8_t i = 0; i < (ETHERNET_MAX_SOCKET_SERVER*ETHERNET_MAX_LISTEN_CLIENT); ++i)
-    {
-        // Init buffer pointer
-        EthernetServerSocket_listenClients[i].rxBufferHead = 0;
-        EthernetServerSocket_listenClients[i].rxBufferTail = 0;
 
-        EthernetServerSocket_listenClients[i].status = ETHERNETSOCKET_STATUS_INIT;
+        for (uint8_t j = 0; j < config->maxClients; ++j)
+        {
+            EthernetServerSocket_Client* client =
+                    &EthernetServerSocket_listenClients[config->firstClient + j];
+
+            // Init buffer pointer
+            EthernetServerSocket_clientData[config->firstClient + j].rxBuffer =
+                    config->rxBuffer + ((uint32_t)j * (config->bufferMask + 1));
+            EthernetServerSocket_clientData[config->firstClient + j].txBuffer =
+                    config->txBuffer + ((uint32_t)j * (config->txBufferMask + 1));
+            client->rxBufferHead = 0;
+            client->rxBufferTail = 0;
+            client->txBufferHead = 0;
+            client->txBufferTail = 0;
+
+            client->server = i;
+            client->flags = 0;
+            // Zero is never used, so ETHERNETSERVERSOCKET_HANDLE_INVALID is stale
+            client->generation = 1;
+            client->status = ETHERNETSOCKET_STATUS_INIT;
+        }
     }
 
     EthernetServerSocket_isInit = TRUE;
 }
 
-EthernetSocket_Error EthernetServerSocket_connect (uint8_t number,
-                                                   uint16_t port)
+EthernetSocket_Error EthernetServerSocket_connect (uint8_t number)
 {
     err_t error;
 
     // Check if the socket exist
-    if (number >= ETHERNET_MAX_SOCKET_SERVER)
+    if (number >= ETHERNETSERVERSOCKET_SERVERS)
         return ETHERNETSOCKET_ERROR_WRONG_SOCKET_NUMBER;
 
     // Check if the socket is just in use!
@@ -227,27 +616,32 @@ EthernetSocket_Error EthernetServerSocket_connect (uint8_t number,
 
     EthernetServerSocket_Device *dev = &EthernetServerSocket_socket[number];
 
-    // Save connection data
-    dev->port = port;
+    // The scheduled policies need the transmit buffers
+    if ((dev->config->txPolicy >= ETHERNETSERVERSOCKET_TXPOLICY_ROUND_ROBIN) &&
+        (dev->config->txBufferMask == 0))
+        return ETHERNETSOCKET_ERROR_OPEN_FAIL;
 
     // Initialize process control block for application
-    // and select TCP as protocol
-    dev->pcb = tcp_new();
+    // and select TCP or TLS as protocol
+    dev->pcb = EthernetSocket_tcpNew(dev->tls);
     if (dev->pcb)
     {
-        error = tcp_bind(dev->pcb, IP_ADDR_ANY, port);
+        error = EthernetSocket_tcpBind(dev->pcb, IP_ADDR_ANY, dev->config->port);
         if (error != ERR_OK)
         {
-            tcp_abort(dev->pcb);
+            EthernetSocket_tcpAbort(dev->pcb);
             return ETHERNETSOCKET_ERROR_BUFFER_NO_DATA;
         }
 
         // Set up the local port to listen for incoming connections
-        dev->pcb = tcp_listen(dev->pcb);
-        tcp_arg(dev->pcb,dev);
-        tcp_setprio(dev->pcb, TCP_PRIO_NORMAL);
+        dev->pcb = EthernetSocket_tcpListen(dev->pcb);
+        EthernetSocket_tcpArg(dev->pcb,dev);
+        if (dev->config->priority != 0)
+            EthernetSocket_tcpSetprio(dev->pcb, dev->config->priority);
+        else
+            EthernetSocket_tcpSetprio(dev->pcb, TCP_PRIO_NORMAL);
         // It's ready for incoming connections
-        tcp_accept(dev->pcb, EthernetServerSocket_connectionHandle);
+        EthernetSocket_tcpAccept(dev->pcb, EthernetServerSocket_connectionHandle);
 
         // Set server to wait connection status
         dev->status = ETHERNETSOCKET_STATUS_WAIT_CONNECTION;
@@ -259,24 +653,44 @@ EthernetSocket_Error EthernetServerSocket_connect (uint8_t number,
     // FIXME: parse other error!!
 }
 
+#if LWIP_ALTCP_TLS
+EthernetSocket_Error EthernetServerSocket_setTls (uint8_t number,
+                                                 struct altcp_tls_config* config)
+{
+    // Check if the socket exist
+    if (number >= ETHERNETSERVERSOCKET_SERVERS)
+        return ETHERNETSOCKET_ERROR_WRONG_SOCKET_NUMBER;
+
+    // The transport can't change while the server is open
+    if ((EthernetServerSocket_socket[number].status == ETHERNETSOCKET_STATUS_WAIT_CONNECTION) ||
+        (EthernetServerSocket_socket[number].status == ETHERNETSOCKET_STATUS_CONNECTED))
+        return ETHERNETSOCKET_ERROR_JUST_CONNECTED;
+
+    EthernetServerSocket_socket[number].tls = config;
+    return ETHERNETSOCKET_ERROR_OK;
+}
+#endif
+
 bool EthernetServerSocket_isConnected (uint8_t number,
                                        uint8_t client)
 {
     // Check if the socket exist
-    if (number >= ETHERNET_MAX_SOCKET_SERVER)
-        return ETHERNETSOCKET_ERROR_WRONG_SOCKET_NUMBER;
+    if (number >= ETHERNETSERVERSOCKET_SERVERS)
+        return FALSE;
 
     // Check if the client exist
-    if (client >= ETHERNET_MAX_LISTEN_CLIENT)
-        return ETHERNETSOCKET_ERROR_WRONG_CLIENT_NUMBER;
+    if (client >= EthernetServerSocket_config[number].maxClients)
+        return FALSE;
 
     // Check if the socket is connected!
     if (EthernetServerSocket_socket[number].status != ETHERNETSOCKET_STATUS_CONNECTED)
         return FALSE;
 
-    // Check if the client is connected
-    if (EthernetServerSocket_listenClients[(number * ETHERNET_MAX_LISTEN_CLIENT) + client].status !=
-        ETHERNETSOCKET_STATUS_CONNECTED)
+    // Check if the client is connected, and not closing
+    EthernetServerSocket_Client* dev =
+            &EthernetServerSocket_listenClients[EthernetServerSocket_config[number].firstClient + client];
+    if ((dev->status != ETHERNETSOCKET_STATUS_CONNECTED) ||
+        ((dev->flags & ETHERNETSERVERSOCKET_FLAG_CLOSING) != 0))
         return FALSE;
 
     return TRUE;
@@ -285,7 +699,7 @@ bool EthernetServerSocket_isConnected (uint8_t number,
 EthernetSocket_Error EthernetServerSocket_disconnect (uint8_t number)
 {
     // Check if the socket exist
-    if (number >= ETHERNET_MAX_SOCKET_CLIENT)
+    if (number >= ETHERNETSERVERSOCKET_SERVERS)
         return ETHERNETSOCKET_ERROR_WRONG_SOCKET_NUMBER;
 
     // Check if the socket is connected!
@@ -294,24 +708,12 @@ EthernetSocket_Error EthernetServerSocket_disconnect (uint8_t number)
 
     // Close all client connections
     // FIXME: I don't know if OK!
-    for (uint8_t i = 0; i < ETHERNET_MAX_LISTEN_CLIENT; ++i)
+    for (uint8_t i = 0; i < EthernetServerSocket_config[number].maxClients; ++i)
     {
-        uint8_t tmpClient = (number * ETHERNET_MAX_LISTEN_CLIENT) + i;
-        if (EthernetServerSocket_listenClients[tmpClient].status ==
-            ETHERNETSOCKET_STATUS_CONNECTED)
+        if (EthernetServerSocket_isConnected(number,i) == TRUE)
         {
-            // Close the connection with the client
-            struct tcp_pcb * pcb = EthernetServerSocket_listenClients[tmpClient].clientpcb;
-            tcp_arg(pcb,NULL);
-            tcp_sent(pcb,NULL);
-            tcp_recv(pcb,NULL);
-
-            err_t error = tcp_close(pcb);
-            if (error == ERR_OK)
-            {
-                EthernetServerSocket_listenClients[tmpClient].status =
-                        ETHERNETSOCKET_STATUS_DISCONNECTED;
-            }
+            uint8_t tmpClient = EthernetServerSocket_config[number].firstClient + i;
+            EthernetServerSocket_closeClient(&EthernetServerSocket_listenClients[tmpClient]);
         }
     }
 
@@ -319,15 +721,15 @@ EthernetSocket_Error EthernetServerSocket_disconnect (uint8_t number)
     EthernetServerSocket_Device *dev = &EthernetServerSocket_socket[number];
 
     // Delete all callback and other
-    tcp_arg(dev->pcb,NULL);
-    tcp_sent(dev->pcb,NULL);
-    tcp_recv(dev->pcb,NULL);
+    EthernetSocket_tcpArg(dev->pcb,NULL);
+    EthernetSocket_tcpSent(dev->pcb,NULL);
+    EthernetSocket_tcpRecv(dev->pcb,NULL);
 
-    err_t error = tcp_close(dev->pcb);
+    err_t error = EthernetSocket_tcpClose(dev->pcb);
     if (error == ERR_OK)
     {
+        // The closing clients are counted until their last byte is sent
         dev->status = ETHERNETSOCKET_STATUS_DISCONNECTED;
-        dev->connectedClients = 0;
         return ETHERNETSOCKET_ERROR_OK;
     }
     return ETHERNETSOCKET_ERROR_DISCONNECTION_FAIL;
@@ -336,75 +738,216 @@ EthernetSocket_Error EthernetServerSocket_disconnect (uint8_t number)
 EthernetSocket_Error EthernetServerSocket_disconnectClient (uint8_t number, uint8_t client)
 {
     // Check if the socket exist
-    if (number >= ETHERNET_MAX_SOCKET_SERVER)
+    if (number >= ETHERNETSERVERSOCKET_SERVERS)
         return ETHERNETSOCKET_ERROR_WRONG_SOCKET_NUMBER;
 
+    EthernetServerSocket_Device *dev = &EthernetServerSocket_socket[number];
+
     // Check if the client exist
-    if (client >= ETHERNET_MAX_LISTEN_CLIENT)
+    if (client >= dev->config->maxClients)
         return ETHERNETSOCKET_ERROR_WRONG_CLIENT_NUMBER;
 
-    EthernetServerSocket_Device *dev = &EthernetServerSocket_socket[number];
-
-    uint8_t tmpClient = (number * ETHERNET_MAX_LISTEN_CLIENT) + client;
-    if (EthernetServerSocket_listenClients[tmpClient].status ==
-        ETHERNETSOCKET_STATUS_CONNECTED)
+    uint8_t tmpClient = dev->config->firstClient + client;
+    if ((EthernetServerSocket_listenClients[tmpClient].status ==
+         ETHERNETSOCKET_STATUS_CONNECTED) &&
+        ((EthernetServerSocket_listenClients[tmpClient].flags &
+          ETHERNETSERVERSOCKET_FLAG_CLOSING) == 0))
     {
-        // Close the connection with the client
-        struct tcp_pcb * pcb = EthernetServerSocket_listenClients[tmpClient].clientpcb;
-        tcp_arg(pcb,NULL);
-        tcp_sent(pcb,NULL);
-        tcp_recv(pcb,NULL);
-        tcp_err(pcb,NULL);
-
-        err_t error = tcp_close(pcb);
-        if (error == ERR_OK)
-        {
-            EthernetServerSocket_listenClients[tmpClient].status =
-                    ETHERNETSOCKET_STATUS_DISCONNECTED;
-            dev->connectedClients--;
-        }
+        EthernetServerSocket_closeClient(&EthernetServerSocket_listenClients[tmpClient]);
     }
     return ETHERNETSOCKET_ERROR_OK;
 }
 
-EthernetSocket_Error EthernetServerSocket_available (uint8_t number,
+EthernetSocket_Error EthernetServerSocket_getHandle (uint8_t number,
                                                      uint8_t client,
-                                                     int16_t* available)
+                                                     EthernetServerSocket_Handle* handle)
 {
+    *handle = ETHERNETSERVERSOCKET_HANDLE_INVALID;
+
     if (EthernetServerSocket_isConnected(number,client) == FALSE)
         return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
 
-    uint8_t tmpClient = (number * ETHERNET_MAX_LISTEN_CLIENT) + client;
+    uint8_t tmpClient = EthernetServerSocket_config[number].firstClient + client;
 
-    *available = (EthernetServerSocket_listenClients[tmpClient].rxBufferTail -
-            EthernetServerSocket_listenClients[tmpClient].rxBufferHead);
+    *handle = ETHERNETSERVERSOCKET_HANDLE(tmpClient,
+            EthernetServerSocket_listenClients[tmpClient].generation);
+    return ETHERNETSOCKET_ERROR_OK;
+}
+
+EthernetSocket_Error EthernetServerSocket_disconnectHandle (EthernetServerSocket_Handle handle)
+{
+    if (EthernetServerSocket_isValid(handle) == FALSE)
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
 
+    EthernetServerSocket_closeClient(ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle));
     return ETHERNETSOCKET_ERROR_OK;
 }
 
+EthernetSocket_Error EthernetServerSocket_available (uint8_t number,
+                                                     uint8_t client,
+                                                     int16_t* available)
+{
+    EthernetServerSocket_Handle handle;
+
+    if (EthernetServerSocket_getHandle(number,client,&handle) != ETHERNETSOCKET_ERROR_OK)
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    return EthernetServerSocket_handleAvailable(handle,available);
+}
+
 EthernetSocket_Error EthernetServerSocket_read (uint8_t number,
                                                 uint8_t client,
                                                 uint8_t* data)
 {
+    EthernetServerSocket_Handle handle;
+
     // Clear data
     *data = 0;
 
-    if (EthernetServerSocket_isConnected(number,client) == FALSE)
+    if (EthernetServerSocket_getHandle(number,client,&handle) != ETHERNETSOCKET_ERROR_OK)
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    return EthernetServerSocket_handleRead(handle,data);
+}
+
+EthernetSocket_Error EthernetServerSocket_readBytes (uint8_t number,
+                                                     uint8_t client,
+                                                     uint8_t buffer[],
+                                                     uint16_t length,
+                                                     uint16_t* read)
+{
+    EthernetServerSocket_Handle handle;
+    EthernetSocket_Error error;
+
+    *read = 0;
+
+    if (EthernetServerSocket_getHandle(number,client,&handle) != ETHERNETSOCKET_ERROR_OK)
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    error = EthernetServerSocket_peek(handle,0,buffer,length,read);
+    if (error == ETHERNETSOCKET_ERROR_OK)
+        EthernetServerSocket_commitRead(handle,*read);
+    return error;
+}
+
+EthernetSocket_Error EthernetServerSocket_peek (EthernetServerSocket_Handle handle,
+                                                uint16_t offset,
+                                                uint8_t buffer[],
+                                                uint16_t length,
+                                                uint16_t* read)
+{
+    EthernetServerSocket_Client* dev = ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle);
+
+    *read = 0;
+
+    if (dev->generation != ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle))
         return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
 
-    uint8_t tmpClient = (number * ETHERNET_MAX_LISTEN_CLIENT) + client;
+    uint8_t* rxBuffer = ETHERNETSERVERSOCKET_DATA(dev)->rxBuffer;
+    uint16_t mask = EthernetServerSocket_config[dev->server].bufferMask;
+    uint16_t available = (dev->rxBufferTail - dev->rxBufferHead) & mask;
 
-    // Save a pointer of the requested client
-    EthernetServerSocket_Client *dev = &EthernetServerSocket_listenClients[tmpClient];
+    if (offset >= available)
+        return ETHERNETSOCKET_ERROR_BUFFER_NO_DATA;
 
-    // Read the buffer
-    if (dev->rxBufferTail != dev->rxBufferHead)
+    if (length > (available - offset))
+        length = available - offset;
+
+    // Copy at most two blocks: until the end of the buffer and from its start
+    uint16_t start = (dev->rxBufferHead + offset) & mask;
+    uint16_t first = mask + 1 - start;
+    if (first > length)
+        first = length;
+
+    memcpy(buffer,&rxBuffer[start],first);
+    memcpy(&buffer[first],rxBuffer,length - first);
+
+    *read = length;
+    return ETHERNETSOCKET_ERROR_OK;
+}
+
+EthernetSocket_Error EthernetServerSocket_queueBytes (EthernetServerSocket_Handle handle,
+                                                      uint8_t buffer[],
+                                                      uint16_t length,
+                                                      uint16_t* wrote)
+{
+    EthernetServerSocket_Client* dev = ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle);
+
+    *wrote = 0;
+
+    if (dev->generation != ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle))
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    uint8_t* txBuffer = ETHERNETSERVERSOCKET_DATA(dev)->txBuffer;
+    uint16_t mask = EthernetServerSocket_config[dev->server].txBufferMask;
+    uint16_t space = (dev->txBufferHead - dev->txBufferTail - 1) & mask;
+
+    // The whole write or nothing: only a write longer than the buffer
+    // can't be stored at once
+    if ((length > space) && ((space < mask) || (length <= mask)))
+        return ETHERNETSOCKET_ERROR_BUFFER_FULL;
+
+    if (length > space)
+        length = space;
+
+    // Copy at most two blocks: until the end of the buffer and from its start
+    uint16_t first = mask + 1 - dev->txBufferTail;
+    if (first > length)
+        first = length;
+
+    memcpy(&txBuffer[dev->txBufferTail],buffer,first);
+    memcpy(txBuffer,&buffer[first],length - first);
+    dev->txBufferTail = (dev->txBufferTail + length) & mask;
+    ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_WRITE,dev,length);
+
+    *wrote = length;
+    EthernetServerSocket_txWater(dev);
+    EthernetServerSocket_txSchedule(NULL);
+    return ETHERNETSOCKET_ERROR_OK;
+}
+
+EthernetSocket_Error EthernetServerSocket_handleWriteStatic (EthernetServerSocket_Handle handle,
+                                                             const uint8_t buffer[],
+                                                             uint16_t length,
+                                                             uint16_t* wrote)
+{
+    EthernetServerSocket_Client* dev = ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle);
+
+    *wrote = 0;
+
+    if (dev->generation != ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle))
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    // The bytes must follow the ones into the transmit buffer, as a stream
+    uint16_t mask = EthernetServerSocket_config[dev->server].txBufferMask;
+    if (mask != 0)
     {
-        *data = dev->rxBuffer[dev->rxBufferHead++];
-        dev->rxBufferHead &= ETHERNET_MAX_SOCKET_BUFFER;
-        return ETHERNETSOCKET_ERROR_OK;
+        uint16_t space = (dev->txBufferHead - dev->txBufferTail - 1) & mask;
+        if (length > space)
+            length = space;
+        if (length == 0)
+            return ETHERNETSOCKET_ERROR_BUFFER_FULL;
+        return EthernetServerSocket_queueBytes(handle,(uint8_t*)buffer,length,wrote);
+    }
+
+    uint16_t maxByte = EthernetSocket_tcpSndbuf(dev->clientpcb);
+    if (maxByte < length)
+        length = maxByte;
+    if (length == 0)
+        return ETHERNETSOCKET_ERROR_BUFFER_FULL;
+
+    // Enqueues a reference to the data, without copy
+    if (EthernetSocket_tcpWrite(dev->clientpcb, buffer, length, 0) != ERR_OK)
+        return ETHERNETSOCKET_ERROR_BUFFER_FULL;
+
+    ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_WRITE,dev,length);
+    if (EthernetServerSocket_config[dev->server].txPolicy == ETHERNETSERVERSOCKET_TXPOLICY_IMMEDIATE)
+    {
+        EthernetSocket_tcpOutput(dev->clientpcb);
+        ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_OUTPUT,dev,length);
     }
-    return ETHERNETSOCKET_ERROR_BUFFER_NO_DATA;
+    *wrote = length;
+    return ETHERNETSOCKET_ERROR_OK;
 }
 
 EthernetSocket_Error EthernetServerSocket_clients (uint8_t number, uint8_t* clients)
@@ -413,7 +956,7 @@ EthernetSocket_Error EthernetServerSocket_clients (uint8_t number, uint8_t* clie
     *clients = 0;
 
     // Check if the socket exist
-    if (number >= ETHERNET_MAX_SOCKET_SERVER)
+    if (number >= ETHERNETSERVERSOCKET_SERVERS)
         return ETHERNETSOCKET_ERROR_WRONG_SOCKET_NUMBER;
 
     // Check if the socket is just in use!
@@ -424,16 +967,46 @@ EthernetSocket_Error EthernetServerSocket_clients (uint8_t number, uint8_t* clie
     return ETHERNETSOCKET_ERROR_OK;
 }
 
+bool EthernetServerSocket_wait (uint32_t timeout)
+{
+    uint32_t start = EthernetServerSocket_currentTick();
+
+    while (TRUE)
+    {
+        // The lwIP callbacks run here or into the ethernet interrupt
+        sys_check_timeouts();
+
+        if (EthernetServerSocket_event == TRUE)
+        {
+            EthernetServerSocket_event = FALSE;
+            return TRUE;
+        }
+
+        uint32_t elapsed = EthernetServerSocket_currentTick() - start;
+        if (elapsed >= timeout)
+            return FALSE;
+
+        // Sleep until the next lwIP timeout at most
+        uint32_t sleep = timeout - elapsed;
+#if defined(LWIP_VERSION_MAJOR) && (LWIP_VERSION_MAJOR < 2)
+        if (sleep > TCP_TMR_INTERVAL)
+            sleep = TCP_TMR_INTERVAL;
+#else
+        uint32_t next = sys_timeouts_sleeptime();
+        if (sleep > next)
+            sleep = next;
+#endif
+        if ((EthernetServerSocket_idle != NULL) && (sleep > 0))
+            EthernetServerSocket_idle(sleep);
+    }
+}
+
 EthernetSocket_Error EthernetServerSocket_write (uint8_t number,
                                                  uint8_t client,
                                                  uint8_t data)
 {
-    if (EthernetServerSocket_isConnected(number,client) == FALSE)
-        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
-
     uint16_t wrote = 0;
     return EthernetServerSocket_writeBytes(number,client,&data,1,&wrote);
-
 }
 
 EthernetSocket_Error EthernetServerSocket_writeBytes (uint8_t number,
@@ -442,31 +1015,10 @@ EthernetSocket_Error EthernetServerSocket_writeBytes (uint8_t number,
                                                       uint16_t length,
                                                       uint16_t* wrote)
 {
-    if (EthernetServerSocket_isConnected(number,client) == FALSE)
-        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
-
-    uint8_t tmpClient = (number * ETHERNET_MAX_LISTEN_CLIENT) + client;
-
-    // Save a pointer of the requested client
-    EthernetServerSocket_Client *dev = &EthernetServerSocket_listenClients[tmpClient];
+    EthernetServerSocket_Handle handle;
 
-    uint16_t maxByte = tcp_sndbuf(dev->clientpcb);
-    // Check the available space on the tx buffer
-    if(maxByte < length)
-    {
-        // Set the maximum message length to the available space on the buffer
-        length = maxByte;
-    }
+    if (EthernetServerSocket_getHandle(number,client,&handle) != ETHERNETSOCKET_ERROR_OK)
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
 
-    // Enqueues the data pointed to by buffer
-    if(tcp_write(dev->clientpcb, buffer, length, TCP_WRITE_FLAG_COPY) == ERR_OK)
-    {
-        tcp_output(dev->clientpcb);
-        *wrote = length;
-        return ETHERNETSOCKET_ERROR_OK;
-    }
-    else
-    {
-        return ETHERNETSOCKET_ERROR_BUFFER_FULL;
-    }
+    return EthernetServerSocket_handleWriteBytes(handle,buffer,length,wrote);
 }
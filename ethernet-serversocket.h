@@ -30,6 +30,240 @@
 #define __OHILAB_ETHERNET_SERVERSOCKET_H
 
 #include "ethernet-socket.h"
+#include "ethernet-socket-trace.h"
+#include "ethernet-socket-transport.h"
+
+/**
+ * @ingroup functions
+ * Transmit policy of a server socket.
+ */
+typedef enum
+{
+    ///Every write is sent immediately with tcp_output
+    ETHERNETSERVERSOCKET_TXPOLICY_IMMEDIATE,
+    ///Every write is queued and sent by lwIP on ack or timer
+    ETHERNETSERVERSOCKET_TXPOLICY_DEFERRED,
+    ///Every write is stored in the client transmit buffer, the clients
+    ///send at most quantum bytes each in turn
+    ETHERNETSERVERSOCKET_TXPOLICY_ROUND_ROBIN,
+    ///Like round robin, but the unused quantum of a client is saved
+    ///for its next turn (deficit round robin)
+    ETHERNETSERVERSOCKET_TXPOLICY_DEFICIT,
+} EthernetServerSocket_TxPolicy;
+
+#ifndef ETHERNET_SOCKET_TX_BUDGET
+/**
+ * Maximum number of bytes given to lwIP from the transmit buffers at every
+ * transmit scheduling, it limits the segments taken from the shared lwIP
+ * pool.
+ */
+#define ETHERNET_SOCKET_TX_BUDGET  (4 * TCP_MSS)
+#endif
+
+#ifndef ETHERNET_SOCKET_TX_POLL
+/**
+ * Interval of the lwIP poll that retries the transmit buffers, in coarse
+ * TCP timer ticks (500 ms): it sends the data refused when lwIP had no
+ * memory and nothing was waiting for an ack.
+ */
+#define ETHERNET_SOCKET_TX_POLL  2
+#endif
+
+#ifndef ETHERNET_SOCKET_KEEPALIVE_INTERVAL
+/**
+ * Milliseconds between keepalive probes when keepInterval is 0.
+ */
+#define ETHERNET_SOCKET_KEEPALIVE_INTERVAL  1000
+#endif
+
+#ifndef ETHERNET_SOCKET_KEEPALIVE_COUNT
+/**
+ * Keepalive probes without answer before the client is dropped, when
+ * keepCount is 0.
+ */
+#define ETHERNET_SOCKET_KEEPALIVE_COUNT  3
+#endif
+
+/**
+ * @ingroup functions
+ * Opaque reference to a connected client, made of the client slot and of
+ * the generation of the connection. When the connection is closed the
+ * generation changes and the handle is rejected by all functions.
+ */
+typedef uint32_t EthernetServerSocket_Handle;
+
+#define ETHERNETSERVERSOCKET_HANDLE_INVALID  0
+
+/**
+ * @ingroup functions
+ * Callback called when a new client is connected.
+ * @param[in] number Socket number.
+ * @param[in] client Client number.
+ * @param[in] handle Handle of the new connection.
+ */
+typedef void (*EthernetServerSocket_AcceptCallback) (uint8_t number,
+                                                     uint8_t client,
+                                                     EthernetServerSocket_Handle handle);
+
+/**
+ * @ingroup functions
+ * Callback called when the bytes waiting into the transmit buffer of a
+ * client go over txHighWater (high is TRUE), and when they go back to half
+ * of it (high is FALSE).
+ * @param[in] handle Handle of the connection.
+ * @param[in] high TRUE when the application should stop writing.
+ */
+typedef void (*EthernetServerSocket_TxWaterCallback) (EthernetServerSocket_Handle handle,
+                                                      bool high);
+
+/**
+ * @ingroup functions
+ * Configuration of a server socket, one for each line of
+ * ETHERNET_SERVER_TABLE. The user sets only the first group of fields,
+ * the others are computed from the table.
+ */
+typedef struct _EthernetServerSocket_Config
+{
+    uint16_t port;                                   /**< Listening port */
+    uint8_t priority;         /**< TCP priority, 0 means TCP_PRIO_NORMAL */
+    EthernetServerSocket_TxPolicy txPolicy;             /**< Transmit policy */
+    EthernetServerSocket_AcceptCallback accept;  /**< New client, optional */
+    uint16_t quantum;    /**< Bytes for each scheduler turn, 0 is TCP_MSS */
+    // The keepalive fields exist only when lwIP can use them, so a table
+    // that sets them without LWIP_TCP_KEEPALIVE into lwipopts.h doesn't
+    // build (keepIdle needs it only with altcp)
+#if ETHERNET_SOCKET_KEEPALIVE
+    uint32_t keepIdle;    /**< Idle ms before keepalive probes, 0 disables */
+#endif
+#if LWIP_TCP_KEEPALIVE
+    uint32_t keepInterval;        /**< ms between keepalive probes, 0 default */
+    uint8_t keepCount;   /**< Probes without answer to drop client, 0 default */
+#endif
+    uint16_t txHighWater;      /**< Waiting bytes that call txWater, 0 never */
+    EthernetServerSocket_TxWaterCallback txWater;    /**< Backpressure, optional */
+
+    uint8_t firstClient;            /**< Index of the first client slot */
+    uint8_t maxClients;                      /**< Number of client slots */
+    uint16_t bufferMask;          /**< Receive buffer dimension minus one */
+    uint8_t* rxBuffer;          /**< Receive buffers of all server clients */
+    uint16_t txBufferMask;       /**< Transmit buffer dimension minus one */
+    uint8_t* txBuffer;         /**< Transmit buffers of all server clients */
+} EthernetServerSocket_Config;
+
+#define ETHERNETSERVERSOCKET_ENUM_SERVER(name, clients, ...) \
+    ETHERNETSERVERSOCKET_SERVER_##name,
+
+#define ETHERNETSERVERSOCKET_ENUM_CLIENTS(name, clients, ...) \
+    ETHERNETSERVERSOCKET_CLIENTS_##name = (clients),
+
+#define ETHERNETSERVERSOCKET_ENUM_SLOTS(name, clients, ...)  \
+    ETHERNETSERVERSOCKET_FIRST_##name,                                \
+    ETHERNETSERVERSOCKET_LAST_##name =                                \
+        ETHERNETSERVERSOCKET_FIRST_##name + (clients) - 1,
+
+/**
+ * @ingroup functions
+ * Server socket numbers, ETHERNETSERVERSOCKET_SERVERS is the number of
+ * server sockets.
+ */
+enum
+{
+    ETHERNET_SERVER_TABLE(ETHERNETSERVERSOCKET_ENUM_SERVER)
+    ETHERNETSERVERSOCKET_SERVERS
+};
+
+/**
+ * @ingroup functions
+ * Number of clients of each server socket.
+ */
+enum
+{
+    ETHERNET_SERVER_TABLE(ETHERNETSERVERSOCKET_ENUM_CLIENTS)
+};
+
+/**
+ * @ingroup functions
+ * Client slots of each server socket, ETHERNETSERVERSOCKET_CLIENTS is the
+ * number of client slots of all server sockets.
+ */
+enum
+{
+    ETHERNET_SERVER_TABLE(ETHERNETSERVERSOCKET_ENUM_SLOTS)
+    ETHERNETSERVERSOCKET_CLIENTS
+};
+
+/**
+ * Client flags
+ */
+#define ETHERNETSERVERSOCKET_FLAG_TX_HIGH      0x02  /**< Over txHighWater */
+#define ETHERNETSERVERSOCKET_FLAG_REMOTE_CLOSED 0x04  /**< FIN received */
+#define ETHERNETSERVERSOCKET_FLAG_CLOSING      0x08  /**< Closed, sending */
+
+/*
+ * The client state used at every poll, kept small to scan all clients of
+ * a server reading few cache lines.
+ * It is public only for the inline handle functions, don't use it!
+ */
+typedef struct _EthernetServerSocket_Client
+{
+    EthernetSocket_Pcb *clientpcb;
+
+    uint16_t rxBufferTail;
+    uint16_t rxBufferHead;
+
+    uint16_t txBufferTail;
+    uint16_t txBufferHead;
+
+    uint16_t generation;              /**< Changed at every (dis)connection */
+
+    uint8_t status;                              /**< EthernetSocket_Status */
+    uint8_t flags;
+
+    uint8_t server;                               /**< Server socket number */
+} EthernetServerSocket_Client;
+
+/*
+ * The client state used only when data are moved or errors happen.
+ * It is public only for the inline handle functions, don't use it!
+ */
+typedef struct _EthernetServerSocket_ClientData
+{
+    uint8_t* rxBuffer;
+    uint8_t* txBuffer;
+
+    struct pbuf* rxPending;   /**< Received bytes waiting for buffer space */
+
+    uint16_t deficit;           /**< Bytes the client can send in its turn */
+
+    err_t tcpError;                 /**< TCP error from error handle function */
+} EthernetServerSocket_ClientData;
+
+extern const EthernetServerSocket_Config EthernetServerSocket_config[ETHERNETSERVERSOCKET_SERVERS];
+extern EthernetServerSocket_Client EthernetServerSocket_listenClients[ETHERNETSERVERSOCKET_CLIENTS];
+extern EthernetServerSocket_ClientData EthernetServerSocket_clientData[ETHERNETSERVERSOCKET_CLIENTS];
+
+#define ETHERNETSERVERSOCKET_HANDLE(slot, generation) \
+    (((EthernetServerSocket_Handle)(generation) << 8) | (slot))
+
+#define ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle) \
+    (&EthernetServerSocket_listenClients[(handle) & 0xFF])
+
+#define ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle) \
+    ((uint16_t)((handle) >> 8))
+
+#define ETHERNETSERVERSOCKET_DATA(client) \
+    (&EthernetServerSocket_clientData[(client) - EthernetServerSocket_listenClients])
+
+#define ETHERNETSERVERSOCKET_TRACE(event, client, value)                       \
+    ETHERNETSOCKET_TRACE(event, (client)->server,                              \
+            ((client) - EthernetServerSocket_listenClients) -                  \
+            EthernetServerSocket_config[(client)->server].firstClient, value)
+
+/*
+ * Move the received bytes waiting into lwIP pbufs to the receive buffer.
+ * It is public only for the inline handle functions, don't use it!
+ */
+void EthernetServerSocket_rxRefill (EthernetServerSocket_Client* client);
 
 /**
  * @ingroup functions
@@ -40,14 +274,28 @@ void EthernetServerSocket_init (EthernetSocket_Config* config);
 
 /**
  * @ingroup functions
- * This function enable connections to the selected socket.
+ * This function enable connections to the selected socket, on the port
+ * written in its configuration.
+ * @param number Socket number.
+ * @return ETHERNETSOCKET_ERROR_OK if everything gone well
+ * other errors otherwise.
+ */
+EthernetSocket_Error EthernetServerSocket_connect (uint8_t number);
+
+#if LWIP_ALTCP_TLS
+/**
+ * @ingroup functions
+ * This function selects TLS as transport of the selected socket, it must
+ * be called before EthernetServerSocket_connect().
  * @param number Socket number.
- * @param port Port number.
+ * @param config The TLS configuration, for example from
+ * altcp_tls_create_config_server_privkey_cert(), or NULL for plain TCP.
  * @return ETHERNETSOCKET_ERROR_OK if everything gone well
  * other errors otherwise.
  */
-EthernetSocket_Error EthernetServerSocket_connect (uint8_t number,
-                                                   uint16_t port);
+EthernetSocket_Error EthernetServerSocket_setTls (uint8_t number,
+                                                 struct altcp_tls_config* config);
+#endif
 
 /**
  * @ingroup functions
@@ -71,6 +319,8 @@ EthernetSocket_Error EthernetServerSocket_disconnect (uint8_t number);
 /**
  * @ingroup functions
  * This funcion closes the selected client at the selected server socket
+ * The bytes still into the transmit buffer are sent before the connection
+ * is closed, but the client slot is free only then.
  * @param number The number of socket
  * @param client The number of client
  * @return ETHERNETSOCKET_ERROR_OK if everything gone well
@@ -81,6 +331,10 @@ EthernetSocket_Error EthernetServerSocket_disconnectClient (uint8_t number, uint
 /**
  * @ingroup functions
  * This function checks if new data is available in the selected client.
+ * When the client has closed its side of the connection, the data already
+ * received can still be read (and answered); once they are over this
+ * function closes the connection and returns
+ * ETHERNETSOCKET_ERROR_NOT_CONNECTED.
  * @param[in] number
  * @param[in] client
  * @param[out] available The number of byte in the receive buffer of the
@@ -113,7 +367,9 @@ EthernetSocket_Error EthernetServerSocket_read (uint8_t number,
  * @param[out] buffer The pointer to the array where the function save the bytes read
  * @param[in] length The maximum number of bytes to read
  * @param[out] read The number of bytes read
- * @return
+ * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the client is not connected,
+ * ETHERNETSOCKET_ERROR_BUFFER_NO_DATA if the buffer is empty,
+ * ETHERNETSOCKET_ERROR_OK otherwise.
  */
 EthernetSocket_Error EthernetServerSocket_readBytes (uint8_t number,
                                                      uint8_t client,
@@ -132,6 +388,23 @@ EthernetSocket_Error EthernetServerSocket_readBytes (uint8_t number,
 EthernetSocket_Error EthernetServerSocket_clients (uint8_t number,
                                                    uint8_t* clients);
 
+/**
+ * @ingroup functions
+ * This function runs the lwIP timeouts until a client of any server
+ * receives data, connects, can write again, is closed or has an error, or
+ * until the timeout.
+ * Between the lwIP timeouts it calls the idle callback of the config, with
+ * the maximum ms it can sleep; the callback must return at every
+ * interrupt (for example with WFI). Without idle callback it polls.
+ * The wake callback of the config is called at every event, so a thread
+ * that waits on its own (for example on a condition variable, while lwIP
+ * runs into the tcpip thread) is woken as well.
+ * @param[in] timeout The maximum ms to wait, 0 runs lwIP timeouts once
+ * @return TRUE if there was an event since the previous call, FALSE when
+ * the timeout is expired.
+ */
+bool EthernetServerSocket_wait (uint32_t timeout);
+
 /**
  * @ingroup functions
  * This function writes a char to the selected client.
@@ -148,12 +421,18 @@ EthernetSocket_Error EthernetServerSocket_write (uint8_t number,
 /**
  * @ingroup functions
  * This function writes multiple bytes to the selected client.
+ * When the server has a transmit buffer the bytes are all stored into it
+ * and sent when lwIP has space, otherwise none is stored and the function
+ * returns ETHERNETSOCKET_ERROR_BUFFER_FULL; only a write longer than the
+ * whole buffer is split, and wrote is less than length.
+ * Without transmit buffer the bytes are given to lwIP up to its free space.
  * @param[in] number The number of server
  * @param[in] client The number of the client connected to the server
  * @param[in] buffer The pointer to the array with data must be written
  * @param[in] length The maximum number of bytes to write
  * @param[out] wrote The number of bytes wrote
  * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the client is not connected
+ * ETHERNETSOCKET_ERROR_BUFFER_FULL if there is no space,
  * ETHERNETSOCKET_ERROR_OK otherwise.
  */
 EthernetSocket_Error EthernetServerSocket_writeBytes (uint8_t number,
@@ -162,4 +441,305 @@ EthernetSocket_Error EthernetServerSocket_writeBytes (uint8_t number,
                                                       uint16_t length,
                                                       uint16_t* wrote);
 
+/**
+ * @ingroup functions
+ * This function returns the handle of the selected client, to be used
+ * with the handle functions while the connection is open.
+ * @param[in] number The number of server
+ * @param[in] client The number of the client connected to the server
+ * @param[out] handle The handle of the connection
+ * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the client is not connected
+ * ETHERNETSOCKET_ERROR_OK otherwise.
+ */
+EthernetSocket_Error EthernetServerSocket_getHandle (uint8_t number,
+                                                     uint8_t client,
+                                                     EthernetServerSocket_Handle* handle);
+
+/**
+ * @ingroup functions
+ * This funcion closes the connection of the selected handle.
+ * The handle becomes stale at once, the bytes still into the transmit
+ * buffer are sent before the connection is closed.
+ * @param[in] handle The handle of the connection
+ * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the handle is stale
+ * ETHERNETSOCKET_ERROR_OK otherwise.
+ */
+EthernetSocket_Error EthernetServerSocket_disconnectHandle (EthernetServerSocket_Handle handle);
+
+/**
+ * @ingroup functions
+ * This function stores bytes in the transmit buffer of the selected
+ * handle, and sends them with the scheduler of the server.
+ * Used by EthernetServerSocket_handleWriteBytes(), don't use it!
+ */
+EthernetSocket_Error EthernetServerSocket_queueBytes (EthernetServerSocket_Handle handle,
+                                                      uint8_t buffer[],
+                                                      uint16_t length,
+                                                      uint16_t* wrote);
+
+/**
+ * @ingroup functions
+ * This function checks if the connection of the handle is still open.
+ * Only handles returned by this library can be used.
+ * @param[in] handle The handle of the connection
+ * @return TRUE if the client is connected, FALSE otherwise.
+ */
+static inline bool EthernetServerSocket_isValid (EthernetServerSocket_Handle handle)
+{
+    return (ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle)->generation ==
+            ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle)) ? TRUE : FALSE;
+}
+
+/**
+ * @ingroup functions
+ * This function checks if the client has closed its side of the
+ * connection: no more data will be received, so an incomplete message
+ * into the buffer will never be completed.
+ * @param[in] handle The handle of the connection
+ * @return TRUE if the client has closed, FALSE otherwise.
+ */
+static inline bool EthernetServerSocket_handleRemoteClosed (EthernetServerSocket_Handle handle)
+{
+    return ((ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle)->flags &
+             ETHERNETSERVERSOCKET_FLAG_REMOTE_CLOSED) != 0) ? TRUE : FALSE;
+}
+
+/**
+ * @ingroup functions
+ * This function returns the maximum number of bytes the receive buffer of
+ * the handle can store, the longest message it can wait for.
+ * @param[in] handle The handle of the connection
+ * @return The receive buffer dimension minus one.
+ */
+static inline uint16_t EthernetServerSocket_handleCapacity (EthernetServerSocket_Handle handle)
+{
+    return EthernetServerSocket_config[ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle)->server].bufferMask;
+}
+
+/**
+ * @ingroup functions
+ * Same of EthernetServerSocket_available() for the selected handle.
+ */
+static inline EthernetSocket_Error EthernetServerSocket_handleAvailable (EthernetServerSocket_Handle handle,
+                                                                        int16_t* available)
+{
+    EthernetServerSocket_Client* dev = ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle);
+
+    if (dev->generation != ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle))
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    *available = (dev->rxBufferTail - dev->rxBufferHead) &
+            EthernetServerSocket_config[dev->server].bufferMask;
+
+    // The client closed and all its data are read
+    if ((*available == 0) && ((dev->flags & ETHERNETSERVERSOCKET_FLAG_REMOTE_CLOSED) != 0))
+    {
+        EthernetServerSocket_disconnectHandle(handle);
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+    }
+    return ETHERNETSOCKET_ERROR_OK;
+}
+
+/**
+ * @ingroup functions
+ * Same of EthernetServerSocket_read() for the selected handle.
+ */
+static inline EthernetSocket_Error EthernetServerSocket_handleRead (EthernetServerSocket_Handle handle,
+                                                                   uint8_t* data)
+{
+    EthernetServerSocket_Client* dev = ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle);
+
+    if (dev->generation != ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle))
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    // Read the buffer
+    if (dev->rxBufferTail != dev->rxBufferHead)
+    {
+        *data = ETHERNETSERVERSOCKET_DATA(dev)->rxBuffer[dev->rxBufferHead++];
+        ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_READ,dev,1);
+        dev->rxBufferHead &= EthernetServerSocket_config[dev->server].bufferMask;
+        // Open the receive window of the client
+        EthernetSocket_tcpRecved(dev->clientpcb,1);
+        if (ETHERNETSERVERSOCKET_DATA(dev)->rxPending != NULL)
+            EthernetServerSocket_rxRefill(dev);
+        return ETHERNETSOCKET_ERROR_OK;
+    }
+    return ETHERNETSOCKET_ERROR_BUFFER_NO_DATA;
+}
+
+/**
+ * @ingroup functions
+ * Same of EthernetServerSocket_writeBytes() for the selected handle.
+ */
+static inline EthernetSocket_Error EthernetServerSocket_handleWriteBytes (EthernetServerSocket_Handle handle,
+                                                                         uint8_t buffer[],
+                                                                         uint16_t length,
+                                                                         uint16_t* wrote)
+{
+    EthernetServerSocket_Client* dev = ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle);
+
+    if (dev->generation != ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle))
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    if (EthernetServerSocket_config[dev->server].txBufferMask != 0)
+        return EthernetServerSocket_queueBytes(handle,buffer,length,wrote);
+
+    uint16_t maxByte = EthernetSocket_tcpSndbuf(dev->clientpcb);
+    // Check the available space on the tx buffer
+    if(maxByte < length)
+    {
+        // Set the maximum message length to the available space on the buffer
+        length = maxByte;
+    }
+
+    // Enqueues the data pointed to by buffer
+    if(EthernetSocket_tcpWrite(dev->clientpcb, buffer, length, TCP_WRITE_FLAG_COPY) == ERR_OK)
+    {
+        ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_WRITE,dev,length);
+        // Otherwise lwIP sends the data on next ack or timer
+        if (EthernetServerSocket_config[dev->server].txPolicy == ETHERNETSERVERSOCKET_TXPOLICY_IMMEDIATE)
+        {
+            EthernetSocket_tcpOutput(dev->clientpcb);
+            ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_OUTPUT,dev,length);
+        }
+        *wrote = length;
+        return ETHERNETSOCKET_ERROR_OK;
+    }
+    else
+    {
+        return ETHERNETSOCKET_ERROR_BUFFER_FULL;
+    }
+}
+
+/**
+ * @ingroup functions
+ * This function copies received bytes without removing them from the
+ * circular buffer.
+ * @param[in] handle The handle of the connection
+ * @param[in] offset The position of the first byte, from the oldest one
+ * @param[out] buffer The pointer to the array where the function save the bytes
+ * @param[in] length The maximum number of bytes to copy
+ * @param[out] read The number of bytes copied
+ * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the handle is stale,
+ * ETHERNETSOCKET_ERROR_BUFFER_NO_DATA if there are no bytes after offset,
+ * ETHERNETSOCKET_ERROR_OK otherwise.
+ */
+EthernetSocket_Error EthernetServerSocket_peek (EthernetServerSocket_Handle handle,
+                                                uint16_t offset,
+                                                uint8_t buffer[],
+                                                uint16_t length,
+                                                uint16_t* read);
+
+/**
+ * @ingroup functions
+ * This function returns the largest block of received bytes stored
+ * contiguously in the circular buffer, starting from the oldest one.
+ * The bytes can be parsed in place and remain in the buffer until
+ * EthernetServerSocket_commitRead() is called. When the block ends at
+ * the end of the buffer, the next call returns the remaining bytes.
+ * @param[in] handle The handle of the connection
+ * @param[out] data The pointer to the first byte
+ * @param[out] length The number of bytes of the block
+ * Like EthernetServerSocket_available(), it closes the connection when the
+ * client has closed and the buffer is empty.
+ * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the handle is stale,
+ * ETHERNETSOCKET_ERROR_BUFFER_NO_DATA if the buffer is empty,
+ * ETHERNETSOCKET_ERROR_OK otherwise.
+ */
+static inline EthernetSocket_Error EthernetServerSocket_getReadSpan (EthernetServerSocket_Handle handle,
+                                                                    const uint8_t** data,
+                                                                    uint16_t* length)
+{
+    EthernetServerSocket_Client* dev = ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle);
+
+    *length = 0;
+
+    if (dev->generation != ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle))
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    uint16_t tail = dev->rxBufferTail;
+    uint16_t head = dev->rxBufferHead;
+
+    *data = &ETHERNETSERVERSOCKET_DATA(dev)->rxBuffer[head];
+    if (tail >= head)
+        *length = tail - head;
+    else
+        *length = EthernetServerSocket_config[dev->server].bufferMask + 1 - head;
+
+    if (*length > 0)
+        return ETHERNETSOCKET_ERROR_OK;
+
+    if ((dev->flags & ETHERNETSERVERSOCKET_FLAG_REMOTE_CLOSED) != 0)
+    {
+        EthernetServerSocket_disconnectHandle(handle);
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+    }
+    return ETHERNETSOCKET_ERROR_BUFFER_NO_DATA;
+}
+
+/**
+ * @ingroup functions
+ * This function removes bytes from the circular buffer, usually after
+ * they are parsed with EthernetServerSocket_getReadSpan() or
+ * EthernetServerSocket_peek().
+ * @param[in] handle The handle of the connection
+ * @param[in] length The number of bytes to remove
+ * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the handle is stale,
+ * ETHERNETSOCKET_ERROR_BUFFER_NO_DATA if there are less bytes than length,
+ * ETHERNETSOCKET_ERROR_OK otherwise.
+ */
+static inline EthernetSocket_Error EthernetServerSocket_commitRead (EthernetServerSocket_Handle handle,
+                                                                   uint16_t length)
+{
+    EthernetServerSocket_Client* dev = ETHERNETSERVERSOCKET_HANDLE_CLIENT(handle);
+
+    if (dev->generation != ETHERNETSERVERSOCKET_HANDLE_GENERATION(handle))
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    uint16_t mask = EthernetServerSocket_config[dev->server].bufferMask;
+    if (length > ((dev->rxBufferTail - dev->rxBufferHead) & mask))
+        return ETHERNETSOCKET_ERROR_BUFFER_NO_DATA;
+
+    if (length == 0)
+        return ETHERNETSOCKET_ERROR_OK;
+
+    dev->rxBufferHead = (dev->rxBufferHead + length) & mask;
+    ETHERNETSERVERSOCKET_TRACE(ETHERNETSOCKET_TRACE_READ,dev,length);
+    // Open the receive window of the client
+    EthernetSocket_tcpRecved(dev->clientpcb,length);
+    if (ETHERNETSERVERSOCKET_DATA(dev)->rxPending != NULL)
+        EthernetServerSocket_rxRefill(dev);
+    return ETHERNETSOCKET_ERROR_OK;
+}
+
+/**
+ * @ingroup functions
+ * This function writes multiple bytes to the selected client without copy
+ * them, so they must remain valid until they are sent (as constants into
+ * flash). The servers with a transmit buffer copy them anyway, as many as
+ * fit into the buffer.
+ * @param[in] handle The handle of the connection
+ * @param[in] buffer The pointer to the array with data must be written
+ * @param[in] length The maximum number of bytes to write
+ * @param[out] wrote The number of bytes wrote
+ * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the handle is stale,
+ * ETHERNETSOCKET_ERROR_BUFFER_FULL if there is no space,
+ * ETHERNETSOCKET_ERROR_OK otherwise.
+ */
+EthernetSocket_Error EthernetServerSocket_handleWriteStatic (EthernetServerSocket_Handle handle,
+                                                             const uint8_t buffer[],
+                                                             uint16_t length,
+                                                             uint16_t* wrote);
+
+/**
+ * @ingroup functions
+ * Same of EthernetServerSocket_write() for the selected handle.
+ */
+static inline EthernetSocket_Error EthernetServerSocket_handleWrite (EthernetServerSocket_Handle handle,
+                                                                    uint8_t data)
+{
+    uint16_t wrote = 0;
+    return EthernetServerSocket_handleWriteBytes(handle,&data,1,&wrote);
+}
+
 #endif // __OHILAB_ETHERNET_SERVERSOCKET_H
@@ -0,0 +1,268 @@
+/*
+ * Ethernet Client/Server Socket with libohiboard
+ * Copyright (C) 2017-2018 A. C. Open Hardware Ideas Lab
+ *
+ * Authors:
+ *  Marco Giammarini <m.giammarini@warcomeb.it>
+ *  Matteo Civale
+ *  Gianluca Calignano <g.calignano97@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+
+#include "ethernet-socket-dispatcher.h"
+
+#include <string.h>
+
+/*
+ * The connection of every client slot that is dropping the rest of a too
+ * long frame, until the next delimiter.
+ */
+static EthernetServerSocket_Handle EthernetSocketDispatcher_discard[ETHERNETSERVERSOCKET_CLIENTS];
+
+static void EthernetSocketDispatcher_dispatch (const EthernetSocketDispatcher_Config* dispatcher,
+                                               EthernetServerSocket_Handle handle,
+                                               const uint8_t* frame,
+                                               uint16_t length)
+{
+    EthernetSocketDispatcher_Reply reply = { handle, ETHERNETSOCKET_ERROR_OK };
+    uint16_t keyLength;
+    uint16_t argsStart;
+
+    // Split command and arguments
+    if (dispatcher->keyLength != 0)
+    {
+        keyLength = (length < dispatcher->keyLength) ? length : dispatcher->keyLength;
+        argsStart = keyLength;
+    }
+    else
+    {
+        const uint8_t* separator = memchr(frame,dispatcher->separator,length);
+        keyLength = (separator != NULL) ? (separator - frame) : length;
+        argsStart = (separator != NULL) ? (keyLength + 1) : length;
+    }
+
+    uint32_t index = EthernetSocketDispatcher_hash(frame,keyLength,dispatcher->seed) &
+            dispatcher->mask;
+    const EthernetSocketDispatcher_Command* command = &dispatcher->table[index];
+
+    if ((command->name != NULL) &&
+        (command->length == keyLength) &&
+        (memcmp(command->name,frame,keyLength) == 0))
+    {
+        command->handler(&frame[argsStart],length - argsStart,&reply);
+    }
+    else if (dispatcher->unknown != NULL)
+    {
+        dispatcher->unknown(frame,length,&reply);
+    }
+}
+
+/*
+ * Find the next frame, directly into the receive buffer when it is
+ * contiguous or copied into the scratch buffer when it wraps around.
+ * Return the bytes to remove from the receive buffer, 0 when the frame
+ * isn't complete.
+ */
+static uint16_t EthernetSocketDispatcher_nextFrame (const EthernetSocketDispatcher_Config* dispatcher,
+                                                    EthernetServerSocket_Handle handle,
+                                                    const uint8_t** frame,
+                                                    uint16_t* length,
+                                                    bool* drop)
+{
+    const uint8_t* span;
+    uint16_t spanLength;
+    uint16_t copied;
+    int16_t available;
+
+    *drop = FALSE;
+
+    if (EthernetServerSocket_getReadSpan(handle,&span,&spanLength) != ETHERNETSOCKET_ERROR_OK)
+        return 0;
+    EthernetServerSocket_handleAvailable(handle,&available);
+
+    if (dispatcher->framing == ETHERNETSOCKETDISPATCHER_FRAMING_DELIMITER)
+    {
+        EthernetServerSocket_Handle* discard = &EthernetSocketDispatcher_discard[handle & 0xFF];
+        const uint8_t* end = memchr(span,dispatcher->delimiter,spanLength);
+
+        // The end of a too long frame is not a new frame
+        if (*discard == handle)
+        {
+            *drop = TRUE;
+            if (end == NULL)
+                return spanLength;
+            *discard = ETHERNETSERVERSOCKET_HANDLE_INVALID;
+            return end - span + 1;
+        }
+
+        if (end != NULL)
+        {
+            *frame = span;
+            *length = end - span;
+
+            // Same limit of the frames that wrap around
+            if (*length > dispatcher->maxFrame)
+            {
+                *drop = TRUE;
+                return *length + 1;
+            }
+        }
+        else if (spanLength == (uint16_t)available)
+        {
+            // Not complete, or too long: drop it until the delimiter
+            if (spanLength > dispatcher->maxFrame)
+            {
+                *discard = handle;
+                *drop = TRUE;
+                return spanLength;
+            }
+            return 0;
+        }
+        else
+        {
+            // Wrapped around
+            EthernetServerSocket_peek(handle,0,dispatcher->scratch,dispatcher->maxFrame,&copied);
+            end = memchr(dispatcher->scratch,dispatcher->delimiter,copied);
+            if (end == NULL)
+            {
+                uint8_t next;
+                uint16_t read;
+
+                if (copied < dispatcher->maxFrame)
+                    return 0;
+
+                // A frame of maxFrame bytes ends with the next byte
+                EthernetServerSocket_peek(handle,copied,&next,1,&read);
+                if (read == 0)
+                    return 0;
+                if (next != dispatcher->delimiter)
+                {
+                    // Too long: drop it until the delimiter
+                    *discard = handle;
+                    *drop = TRUE;
+                    return copied;
+                }
+                end = &dispatcher->scratch[copied];
+            }
+            *frame = dispatcher->scratch;
+            *length = end - dispatcher->scratch;
+        }
+
+        // Text lines can end with CR LF
+        uint16_t frameLength = *length + 1;
+        if ((dispatcher->delimiter == '\n') && (*length > 0) && ((*frame)[*length - 1] == '\r'))
+            (*length)--;
+        return frameLength;
+    }
+    else
+    {
+        uint8_t header[2];
+
+        if (EthernetServerSocket_peek(handle,0,header,2,&copied) != ETHERNETSOCKET_ERROR_OK ||
+            copied < 2)
+            return 0;
+
+        *length = ((uint16_t)header[0] << 8) | header[1];
+        if (*length > dispatcher->maxFrame)
+        {
+            // The stream can't be split anymore
+            *drop = TRUE;
+            return (uint16_t)available;
+        }
+        if ((uint16_t)available < (*length + 2))
+            return 0;
+
+        if (spanLength >= (*length + 2))
+        {
+            *frame = &span[2];
+        }
+        else
+        {
+            EthernetServerSocket_peek(handle,2,dispatcher->scratch,*length,&copied);
+            *frame = dispatcher->scratch;
+        }
+        return *length + 2;
+    }
+}
+
+EthernetSocket_Error EthernetSocketDispatcher_process (const EthernetSocketDispatcher_Config* dispatcher,
+                                                       EthernetServerSocket_Handle handle)
+{
+    const uint8_t* frame;
+    uint16_t length;
+    uint16_t consumed;
+    bool drop;
+
+    if (EthernetServerSocket_isValid(handle) == FALSE)
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    // A frame must fit into the receive buffer, or the client stalls
+    if ((dispatcher->maxFrame + 2) > EthernetServerSocket_handleCapacity(handle))
+        return ETHERNETSOCKET_ERROR_WRONG_CONFIG;
+
+    while ((consumed = EthernetSocketDispatcher_nextFrame(dispatcher,handle,&frame,&length,&drop)) > 0)
+    {
+        if ((drop == TRUE) && (dispatcher->framing == ETHERNETSOCKETDISPATCHER_FRAMING_LENGTH))
+        {
+            EthernetServerSocket_disconnectHandle(handle);
+            return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+        }
+
+        if (drop == FALSE)
+            EthernetSocketDispatcher_dispatch(dispatcher,handle,frame,length);
+
+        // The handler can close the connection
+        if (EthernetServerSocket_commitRead(handle,consumed) == ETHERNETSOCKET_ERROR_NOT_CONNECTED)
+            return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+    }
+
+    // Closed when the client has closed, after its last complete frame
+    if (EthernetServerSocket_isValid(handle) == FALSE)
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+    if (EthernetServerSocket_handleRemoteClosed(handle) == TRUE)
+    {
+        EthernetServerSocket_disconnectHandle(handle);
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+    }
+    return ETHERNETSOCKET_ERROR_OK;
+}
+
+EthernetSocket_Error EthernetSocketDispatcher_reply (EthernetSocketDispatcher_Reply* reply,
+                                                     const uint8_t* buffer,
+                                                     uint16_t length)
+{
+    uint16_t wrote;
+
+    while ((length > 0) && (reply->error == ETHERNETSOCKET_ERROR_OK))
+    {
+        reply->error = EthernetServerSocket_handleWriteBytes(reply->handle,
+                                                             (uint8_t*)buffer,
+                                                             length,
+                                                             &wrote);
+        if (reply->error != ETHERNETSOCKET_ERROR_OK)
+            break;
+        if (wrote == 0)
+            reply->error = ETHERNETSOCKET_ERROR_BUFFER_FULL;
+
+        buffer += wrote;
+        length -= wrote;
+    }
+    return reply->error;
+}
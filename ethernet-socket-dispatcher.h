@@ -0,0 +1,180 @@
+/*
+ * Ethernet Client/Server Socket with libohiboard
+ * Copyright (C) 2017-2018 A. C. Open Hardware Ideas Lab
+ *
+ * Authors:
+ *  Marco Giammarini <m.giammarini@warcomeb.it>
+ *  Matteo Civale
+ *  Gianluca Calignano <g.calignano97@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_DISPATCHER_H
+#define __OHILAB_ETHERNET_SOCKET_DISPATCHER_H
+
+#include "ethernet-serversocket.h"
+
+/*
+ * The dispatcher splits the data received by a client into frames, finds
+ * the command of every frame into a perfect hash table and calls its
+ * handler. The lookup is one hash and one compare, whatever the number of
+ * commands.
+ *
+ * The table is generated by tools/ethernet-socket-phash.py, for example:
+ *
+ *   tools/ethernet-socket-phash.py Control get=Control_get set=Control_set
+ *
+ * writes the handler prototypes, Control_SEED, Control_MASK and the
+ * Control_table array, then the dispatcher is:
+ *
+ *   static uint8_t Control_scratch[128];
+ *
+ *   static const EthernetSocketDispatcher_Config Control_dispatcher =
+ *   {
+ *       .table     = Control_table,
+ *       .seed      = Control_SEED,
+ *       .mask      = Control_MASK,
+ *       .framing   = ETHERNETSOCKETDISPATCHER_FRAMING_DELIMITER,
+ *       .delimiter = '\n',
+ *       .separator = ' ',
+ *       .maxFrame  = sizeof(Control_scratch),
+ *       .scratch   = Control_scratch,
+ *   };
+ *
+ * and EthernetSocketDispatcher_process(&Control_dispatcher,handle) is
+ * called for every client in the main loop.
+ */
+
+/**
+ * @ingroup functions
+ * How the received data are split into frames.
+ */
+typedef enum
+{
+    ///Every frame ends with the delimiter byte
+    ETHERNETSOCKETDISPATCHER_FRAMING_DELIMITER,
+    ///Every frame starts with its length, two bytes big endian
+    ETHERNETSOCKETDISPATCHER_FRAMING_LENGTH,
+} EthernetSocketDispatcher_Framing;
+
+/**
+ * @ingroup functions
+ * Where the handler writes its reply.
+ */
+typedef struct _EthernetSocketDispatcher_Reply
+{
+    EthernetServerSocket_Handle handle;          /**< The client connection */
+    EthernetSocket_Error error;                  /**< First error of reply */
+} EthernetSocketDispatcher_Reply;
+
+/**
+ * @ingroup functions
+ * Command handler.
+ * @param[in] args The arguments of the command, they point into the receive
+ * buffer and are valid only during the call
+ * @param[in] length The number of bytes of the arguments
+ * @param[in] reply The reply writer, see EthernetSocketDispatcher_reply()
+ */
+typedef void (*EthernetSocketDispatcher_Handler) (const uint8_t* args,
+                                                  uint16_t length,
+                                                  EthernetSocketDispatcher_Reply* reply);
+
+/**
+ * @ingroup functions
+ * An entry of the perfect hash table, the unused entries have no name.
+ */
+typedef struct _EthernetSocketDispatcher_Command
+{
+    const char* name;
+    uint16_t length;                       /**< Number of bytes of the name */
+    EthernetSocketDispatcher_Handler handler;
+} EthernetSocketDispatcher_Command;
+
+/**
+ * @ingroup functions
+ * Dispatcher configuration, usually a const in flash.
+ */
+typedef struct _EthernetSocketDispatcher_Config
+{
+    const EthernetSocketDispatcher_Command* table; /**< Generated table */
+    uint32_t seed;                                  /**< Generated seed */
+    uint16_t mask;            /**< Generated mask, table dimension minus one */
+
+    EthernetSocketDispatcher_Framing framing;
+    uint8_t delimiter;               /**< End of frame for delimiter framing */
+    uint8_t separator;                /**< Between command and arguments */
+    uint8_t keyLength;     /**< Fixed command length, 0 to use the separator */
+
+    uint16_t maxFrame;  /**< Maximum bytes of a frame, less than rx buffer - 2 */
+    uint8_t* scratch;       /**< maxFrame bytes, for frames that wrap around */
+
+    EthernetSocketDispatcher_Handler unknown;  /**< Unknown command, optional */
+} EthernetSocketDispatcher_Config;
+
+/**
+ * @ingroup functions
+ * The hash of the perfect hash table (FNV-1a with seed, high bits folded
+ * into the low ones), the same of
+ * tools/ethernet-socket-phash.py.
+ */
+static inline uint32_t EthernetSocketDispatcher_hash (const uint8_t* key,
+                                                      uint16_t length,
+                                                      uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+
+    for (uint16_t i = 0; i < length; ++i)
+    {
+        hash ^= key[i];
+        hash *= 16777619u;
+    }
+    // The low bits of FNV-1a depend only on the low bits of the seed
+    return hash ^ (hash >> 16);
+}
+
+/**
+ * @ingroup functions
+ * This function handles all complete frames received by the client.
+ * @param[in] dispatcher The dispatcher configuration
+ * @param[in] handle The handle of the connection
+ * A delimited frame longer than maxFrame is dropped until its delimiter, a
+ * length frame longer than maxFrame closes the connection.
+ * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the handle is stale
+ * ETHERNETSOCKET_ERROR_WRONG_CONFIG if maxFrame doesn't fit into the
+ * receive buffer of the client, ETHERNETSOCKET_ERROR_OK otherwise.
+ */
+EthernetSocket_Error EthernetSocketDispatcher_process (const EthernetSocketDispatcher_Config* dispatcher,
+                                                       EthernetServerSocket_Handle handle);
+
+/**
+ * @ingroup functions
+ * This function writes bytes of the reply, it can be called many times
+ * by a handler.
+ * @param[in] reply The reply writer of the handler
+ * @param[in] buffer The bytes to write
+ * @param[in] length The number of bytes
+ * @return ETHERNETSOCKET_ERROR_OK if all bytes are written, other errors
+ * otherwise.
+ */
+EthernetSocket_Error EthernetSocketDispatcher_reply (EthernetSocketDispatcher_Reply* reply,
+                                                     const uint8_t* buffer,
+                                                     uint16_t length);
+
+#endif // __OHILAB_ETHERNET_SOCKET_DISPATCHER_H
@@ -0,0 +1,473 @@
+/*
+ * Ethernet Client/Server Socket with libohiboard
+ * Copyright (C) 2017-2018 A. C. Open Hardware Ideas Lab
+ *
+ * Authors:
+ *  Marco Giammarini <m.giammarini@warcomeb.it>
+ *  Matteo Civale
+ *  Gianluca Calignano <g.calignano97@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+
+#include "ethernet-socket-http.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Body length of the header: chunked, or until the connection is closed */
+#define ETHERNETSOCKETHTTP_LENGTH_CHUNKED  (-1)
+#define ETHERNETSOCKETHTTP_LENGTH_CLOSE    (-2)
+
+/*
+ * The state of every client slot: the static body not sent yet, and if
+ * the connection must be closed after the response.
+ */
+typedef struct _EthernetSocketHttp_Connection
+{
+    EthernetServerSocket_Handle handle;
+
+    const uint8_t* body;
+    uint32_t remaining;
+
+    bool close;
+} EthernetSocketHttp_Connection;
+
+static EthernetSocketHttp_Connection EthernetSocketHttp_connections[ETHERNETSERVERSOCKET_CLIENTS];
+
+static bool EthernetSocketHttp_equals (const char* text,
+                                       uint16_t length,
+                                       const char* name)
+{
+    for (uint16_t i = 0; i < length; ++i)
+    {
+        char a = text[i];
+        char b = name[i];
+
+        if (b == 0)
+            return FALSE;
+        if ((a >= 'A') && (a <= 'Z')) a += 'a' - 'A';
+        if ((b >= 'A') && (b <= 'Z')) b += 'a' - 'A';
+        if (a != b)
+            return FALSE;
+    }
+    return (name[length] == 0) ? TRUE : FALSE;
+}
+
+static const char* EthernetSocketHttp_find (const char* text,
+                                            uint16_t length,
+                                            const char* pattern)
+{
+    uint16_t patternLength = strlen(pattern);
+
+    for (uint16_t i = 0; (i + patternLength) <= length; ++i)
+    {
+        if (memcmp(&text[i],pattern,patternLength) == 0)
+            return &text[i];
+    }
+    return NULL;
+}
+
+bool EthernetSocketHttp_header (const EthernetSocketHttp_Request* request,
+                                const char* name,
+                                const char** value,
+                                uint16_t* length)
+{
+    const char* line = request->headers;
+    const char* end = request->headers + request->headersLength;
+
+    while (line < end)
+    {
+        const char* lineEnd = EthernetSocketHttp_find(line,end - line,"\r\n");
+        if (lineEnd == NULL)
+            lineEnd = end;
+
+        const char* colon = memchr(line,':',lineEnd - line);
+        if ((colon != NULL) && (EthernetSocketHttp_equals(line,colon - line,name) == TRUE))
+        {
+            // Skip spaces around the value
+            *value = colon + 1;
+            while ((*value < lineEnd) && (**value == ' ')) (*value)++;
+            *length = lineEnd - *value;
+            while ((*length > 0) && ((*value)[*length - 1] == ' ')) (*length)--;
+            return TRUE;
+        }
+        line = lineEnd + 2;
+    }
+    return FALSE;
+}
+
+static EthernetSocket_Error EthernetSocketHttp_send (EthernetServerSocket_Handle handle,
+                                                     const uint8_t* buffer,
+                                                     uint16_t length)
+{
+    EthernetSocket_Error error = ETHERNETSOCKET_ERROR_OK;
+    uint16_t wrote;
+
+    while ((length > 0) && (error == ETHERNETSOCKET_ERROR_OK))
+    {
+        error = EthernetServerSocket_handleWriteBytes(handle,(uint8_t*)buffer,length,&wrote);
+        if ((error == ETHERNETSOCKET_ERROR_OK) && (wrote == 0))
+            error = ETHERNETSOCKET_ERROR_BUFFER_FULL;
+        if (error == ETHERNETSOCKET_ERROR_OK)
+        {
+            buffer += wrote;
+            length -= wrote;
+        }
+    }
+    return error;
+}
+
+static EthernetSocket_Error EthernetSocketHttp_sendHeader (EthernetServerSocket_Handle handle,
+                                                           const char* status,
+                                                           const char* contentType,
+                                                           int32_t length,
+                                                           bool close)
+{
+    char header[160];
+    char bodyLength[32] = "Transfer-Encoding: chunked\r\n";
+    int size;
+
+    if (length == ETHERNETSOCKETHTTP_LENGTH_CLOSE)
+        bodyLength[0] = 0;
+    else if (length >= 0)
+        snprintf(bodyLength,sizeof(bodyLength),"Content-Length: %ld\r\n",(long)length);
+
+    // The whole header at once, a too long content type is an error
+    size = snprintf(header,sizeof(header),
+                    "HTTP/1.1 %s\r\nContent-Type: %s\r\n%s%s\r\n",
+                    status,
+                    contentType,
+                    (close == TRUE) ? "Connection: close\r\n" : "",
+                    bodyLength);
+    if ((size < 0) || (size >= (int)sizeof(header)))
+        return ETHERNETSOCKET_ERROR_BUFFER_FULL;
+
+    return EthernetSocketHttp_send(handle,(const uint8_t*)header,size);
+}
+
+EthernetSocket_Error EthernetSocketHttp_write (EthernetSocketHttp_Response* response,
+                                               const uint8_t* buffer,
+                                               uint16_t length)
+{
+    char size[8];
+
+    // An empty chunk is the end of the body
+    if ((length == 0) || (response->error != ETHERNETSOCKET_ERROR_OK))
+        return response->error;
+
+    // HTTP/1.0: the body ends with the connection
+    if (response->chunked == FALSE)
+    {
+        response->error = EthernetSocketHttp_send(response->handle,buffer,length);
+        return response->error;
+    }
+
+    snprintf(size,sizeof(size),"%X\r\n",length);
+    response->error = EthernetSocketHttp_send(response->handle,(const uint8_t*)size,strlen(size));
+    if (response->error == ETHERNETSOCKET_ERROR_OK)
+        response->error = EthernetSocketHttp_send(response->handle,buffer,length);
+    if (response->error == ETHERNETSOCKET_ERROR_OK)
+        response->error = EthernetSocketHttp_send(response->handle,(const uint8_t*)"\r\n",2);
+    return response->error;
+}
+
+/*
+ * Send the static body not sent yet, return TRUE when all is sent.
+ */
+static bool EthernetSocketHttp_continue (EthernetSocketHttp_Connection* connection)
+{
+    uint16_t wrote;
+
+    while (connection->remaining > 0)
+    {
+        uint16_t length = (connection->remaining > 0xFFFF) ? 0xFFFF : connection->remaining;
+
+        if (EthernetServerSocket_handleWriteStatic(connection->handle,
+                                                   connection->body,
+                                                   length,
+                                                   &wrote) != ETHERNETSOCKET_ERROR_OK)
+            return FALSE;
+
+        connection->body += wrote;
+        connection->remaining -= wrote;
+    }
+    return TRUE;
+}
+
+/*
+ * Parse the request line and the headers of a complete request.
+ */
+static bool EthernetSocketHttp_parse (const char* text,
+                                      uint16_t headerLength,
+                                      EthernetSocketHttp_Request* request,
+                                      bool* close,
+                                      bool* chunked)
+{
+    const char* end = text + headerLength;
+    const char* lineEnd = EthernetSocketHttp_find(text,headerLength,"\r\n");
+    const char* space;
+
+    // Method
+    space = memchr(text,' ',lineEnd - text);
+    if (space == NULL)
+        return FALSE;
+    request->method = text;
+    request->methodLength = space - text;
+
+    // Target
+    request->path = space + 1;
+    space = memchr(request->path,' ',lineEnd - request->path);
+    if (space == NULL)
+        return FALSE;
+    request->pathLength = space - request->path;
+    request->query = space;
+    request->queryLength = 0;
+    const char* mark = memchr(request->path,'?',request->pathLength);
+    if (mark != NULL)
+    {
+        request->query = mark + 1;
+        request->queryLength = space - request->query;
+        request->pathLength = mark - request->path;
+    }
+
+    // Version: HTTP/1.0 closes by default and has no chunked encoding
+    *close = ((lineEnd - space - 1) == 8) && (memcmp(space + 1,"HTTP/1.0",8) == 0);
+    *chunked = (*close == TRUE) ? FALSE : TRUE;
+
+    request->headers = lineEnd + 2;
+    request->headersLength = (end > request->headers) ? (end - request->headers) : 0;
+
+    const char* value;
+    uint16_t length;
+    if (EthernetSocketHttp_header(request,"Connection",&value,&length) == TRUE)
+    {
+        if (EthernetSocketHttp_equals(value,length,"close") == TRUE)
+            *close = TRUE;
+        else if (EthernetSocketHttp_equals(value,length,"keep-alive") == TRUE)
+            *close = FALSE;
+    }
+    return TRUE;
+}
+
+static void EthernetSocketHttp_answer (const EthernetSocketHttp_Config* http,
+                                       EthernetSocketHttp_Connection* connection,
+                                       const EthernetSocketHttp_Request* request,
+                                       bool chunked)
+{
+    const EthernetSocketHttp_Route* route = NULL;
+
+    for (uint8_t i = 0; i < http->routesCount; ++i)
+    {
+        if ((EthernetSocketHttp_equals(request->method,request->methodLength,http->routes[i].method) == TRUE) &&
+            (strlen(http->routes[i].path) == request->pathLength) &&
+            (memcmp(request->path,http->routes[i].path,request->pathLength) == 0))
+        {
+            route = &http->routes[i];
+            break;
+        }
+    }
+
+    if (route == NULL)
+    {
+        if (EthernetSocketHttp_sendHeader(connection->handle,"404 Not Found","text/plain",0,
+                                          connection->close) != ETHERNETSOCKET_ERROR_OK)
+            connection->close = TRUE;
+    }
+    else if (route->body != NULL)
+    {
+        if (EthernetSocketHttp_sendHeader(connection->handle,"200 OK",route->contentType,
+                                          route->length,connection->close) != ETHERNETSOCKET_ERROR_OK)
+        {
+            connection->close = TRUE;
+            return;
+        }
+        // Sent without copy, now or at the next calls
+        connection->body = route->body;
+        connection->remaining = route->length;
+        EthernetSocketHttp_continue(connection);
+    }
+    else
+    {
+        EthernetSocketHttp_Response response = { connection->handle, ETHERNETSOCKET_ERROR_OK, chunked };
+
+        // Without chunked encoding only the close ends the body
+        if (chunked == FALSE)
+            connection->close = TRUE;
+
+        response.error = EthernetSocketHttp_sendHeader(connection->handle,"200 OK",route->contentType,
+                                                       (chunked == TRUE) ?
+                                                               ETHERNETSOCKETHTTP_LENGTH_CHUNKED :
+                                                               ETHERNETSOCKETHTTP_LENGTH_CLOSE,
+                                                       connection->close);
+        route->handler(request,&response);
+        if ((response.error == ETHERNETSOCKET_ERROR_OK) && (chunked == TRUE))
+            response.error = EthernetSocketHttp_send(connection->handle,(const uint8_t*)"0\r\n\r\n",5);
+
+        // The body is broken, the client must see the end of connection
+        if (response.error != ETHERNETSOCKET_ERROR_OK)
+            connection->close = TRUE;
+    }
+}
+
+/*
+ * The request is not complete: wait for the next bytes, or close when the
+ * client has closed its side and they will never arrive.
+ */
+static EthernetSocket_Error EthernetSocketHttp_incomplete (EthernetServerSocket_Handle handle)
+{
+    if (EthernetServerSocket_handleRemoteClosed(handle) == TRUE)
+    {
+        EthernetServerSocket_disconnectHandle(handle);
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+    }
+    return ETHERNETSOCKET_ERROR_OK;
+}
+
+EthernetSocket_Error EthernetSocketHttp_process (const EthernetSocketHttp_Config* http,
+                                                 EthernetServerSocket_Handle handle)
+{
+    EthernetSocketHttp_Connection* connection =
+            &EthernetSocketHttp_connections[handle & 0xFF];
+
+    if (EthernetServerSocket_isValid(handle) == FALSE)
+        return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+
+    // A request must fit into the receive buffer, or the client stalls
+    if (http->maxRequest > EthernetServerSocket_handleCapacity(handle))
+        return ETHERNETSOCKET_ERROR_WRONG_CONFIG;
+
+    // New connection into the slot
+    if (connection->handle != handle)
+    {
+        connection->handle = handle;
+        connection->remaining = 0;
+        connection->close = FALSE;
+    }
+
+    while (TRUE)
+    {
+        const uint8_t* span;
+        uint16_t spanLength;
+        int16_t available;
+        const char* text;
+        uint16_t copied;
+
+        // The previous response is not finished: the next waits
+        if (EthernetSocketHttp_continue(connection) == FALSE)
+            return ETHERNETSOCKET_ERROR_OK;
+
+        if (connection->close == TRUE)
+        {
+            EthernetServerSocket_disconnectHandle(handle);
+            return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+        }
+
+        // Closed when the client has closed and all requests are answered
+        EthernetSocket_Error error = EthernetServerSocket_getReadSpan(handle,&span,&spanLength);
+        if (error != ETHERNETSOCKET_ERROR_OK)
+            return (error == ETHERNETSOCKET_ERROR_NOT_CONNECTED) ? error : ETHERNETSOCKET_ERROR_OK;
+        EthernetServerSocket_handleAvailable(handle,&available);
+
+        // Parse in place when the request is contiguous
+        text = (const char*)span;
+        const char* end = EthernetSocketHttp_find(text,spanLength,"\r\n\r\n");
+        if ((end == NULL) && (spanLength < (uint16_t)available))
+        {
+            EthernetServerSocket_peek(handle,0,http->scratch,http->maxRequest,&copied);
+            text = (const char*)http->scratch;
+            spanLength = copied;
+            end = EthernetSocketHttp_find(text,copied,"\r\n\r\n");
+        }
+
+        if (end == NULL)
+        {
+            if ((uint16_t)available < http->maxRequest)
+                return EthernetSocketHttp_incomplete(handle);
+
+            // Too long, the stream can't be parsed anymore
+            connection->close = TRUE;
+            EthernetSocketHttp_sendHeader(handle,"413 Payload Too Large","text/plain",0,TRUE);
+            continue;
+        }
+
+        EthernetSocketHttp_Request request;
+        bool chunked;
+        uint16_t headerLength = end - text + 2;
+        uint16_t requestLength = headerLength + 2;
+
+        if (EthernetSocketHttp_parse(text,headerLength,&request,&connection->close,&chunked) == FALSE)
+        {
+            connection->close = TRUE;
+            EthernetSocketHttp_sendHeader(handle,"400 Bad Request","text/plain",0,TRUE);
+            continue;
+        }
+
+        // Body
+        const char* value;
+        uint16_t length;
+        request.body = (const uint8_t*)end + 4;
+        request.bodyLength = 0;
+        if (EthernetSocketHttp_header(&request,"Content-Length",&value,&length) == TRUE)
+        {
+            uint32_t bodyLength = 0;
+            uint16_t i;
+
+            // Stop as soon as the request is too long, before it can wrap
+            for (i = 0; (i < length) && (value[i] >= '0') && (value[i] <= '9'); ++i)
+            {
+                bodyLength = (bodyLength * 10) + (value[i] - '0');
+                if ((requestLength + bodyLength) > http->maxRequest)
+                    break;
+            }
+
+            if ((requestLength + bodyLength) > http->maxRequest)
+            {
+                connection->close = TRUE;
+                EthernetSocketHttp_sendHeader(handle,"413 Payload Too Large","text/plain",0,TRUE);
+                continue;
+            }
+            // Empty, or not only digits
+            if ((length == 0) || (i < length))
+            {
+                connection->close = TRUE;
+                EthernetSocketHttp_sendHeader(handle,"400 Bad Request","text/plain",0,TRUE);
+                continue;
+            }
+            if ((uint16_t)available < (requestLength + bodyLength))
+                return EthernetSocketHttp_incomplete(handle);
+            if ((text == (const char*)span) && (spanLength < (requestLength + bodyLength)))
+            {
+                // The body wraps around: parse again from the copy
+                EthernetServerSocket_peek(handle,0,http->scratch,requestLength + bodyLength,&copied);
+                text = (const char*)http->scratch;
+                EthernetSocketHttp_parse(text,headerLength,&request,&connection->close,&chunked);
+            }
+            request.body = (const uint8_t*)text + requestLength;
+            request.bodyLength = bodyLength;
+            requestLength += bodyLength;
+        }
+
+        EthernetSocketHttp_answer(http,connection,&request,chunked);
+
+        // Pipelined requests are answered at the next loop
+        if (EthernetServerSocket_commitRead(handle,requestLength) != ETHERNETSOCKET_ERROR_OK)
+            return ETHERNETSOCKET_ERROR_NOT_CONNECTED;
+    }
+}
@@ -0,0 +1,173 @@
+/*
+ * Ethernet Client/Server Socket with libohiboard
+ * Copyright (C) 2017-2018 A. C. Open Hardware Ideas Lab
+ *
+ * Authors:
+ *  Marco Giammarini <m.giammarini@warcomeb.it>
+ *  Matteo Civale
+ *  Gianluca Calignano <g.calignano97@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_HTTP_H
+#define __OHILAB_ETHERNET_SOCKET_HTTP_H
+
+#include "ethernet-serversocket.h"
+
+/*
+ * Minimal HTTP/1.1 server over a server socket. The connections are kept
+ * open between requests (unless the client asks to close, or speaks
+ * HTTP/1.0 without keep-alive) and pipelined requests are answered in
+ * order. The request line and the headers are parsed in place into the
+ * receive buffer, so the receive buffer of the server must hold the
+ * largest request.
+ *
+ * Every route answers with a static body (for example a page or a file
+ * into flash) sent without copy, or with a handler that writes the body
+ * in chunks (HTTP/1.0 clients get the body until the connection closes):
+ *
+ *   static const EthernetSocketHttp_Route Web_routes[] =
+ *   {
+ *       { "GET", "/",       "text/html",        Web_index, sizeof(Web_index), 0 },
+ *       { "GET", "/status", "application/json", 0, 0, Web_status },
+ *   };
+ *
+ *   static uint8_t Web_scratch[512];
+ *
+ *   static const EthernetSocketHttp_Config Web_http =
+ *   {
+ *       .routes      = Web_routes,
+ *       .routesCount = 2,
+ *       .maxRequest  = sizeof(Web_scratch),
+ *       .scratch     = Web_scratch,
+ *   };
+ *
+ * and EthernetSocketHttp_process(&Web_http,handle) is called for every
+ * client in the main loop.
+ */
+
+/**
+ * @ingroup functions
+ * A request, all fields point into the receive buffer and are valid only
+ * during the handler call.
+ */
+typedef struct _EthernetSocketHttp_Request
+{
+    const char* method;
+    uint16_t methodLength;
+    const char* path;                        /**< Path without the query */
+    uint16_t pathLength;
+    const char* query;                       /**< After '?', can be empty */
+    uint16_t queryLength;
+    const char* headers;            /**< All header lines, see header() */
+    uint16_t headersLength;
+    const uint8_t* body;
+    uint16_t bodyLength;
+} EthernetSocketHttp_Request;
+
+/**
+ * @ingroup functions
+ * Where the handler writes the body of the response.
+ */
+typedef struct _EthernetSocketHttp_Response
+{
+    EthernetServerSocket_Handle handle;          /**< The client connection */
+    EthernetSocket_Error error;                  /**< First error of write */
+    bool chunked;           /**< FALSE for HTTP/1.0, the close ends the body */
+} EthernetSocketHttp_Response;
+
+/**
+ * @ingroup functions
+ * Handler of a dynamic route, see EthernetSocketHttp_write().
+ */
+typedef void (*EthernetSocketHttp_Handler) (const EthernetSocketHttp_Request* request,
+                                            EthernetSocketHttp_Response* response);
+
+/**
+ * @ingroup functions
+ * A route, usually into a const table in flash.
+ */
+typedef struct _EthernetSocketHttp_Route
+{
+    const char* method;
+    const char* path;
+    const char* contentType;
+    const uint8_t* body;            /**< Static body, NULL to use handler */
+    uint32_t length;                    /**< Number of bytes of the body */
+    EthernetSocketHttp_Handler handler;
+} EthernetSocketHttp_Route;
+
+/**
+ * @ingroup functions
+ * HTTP server configuration, usually a const in flash.
+ */
+typedef struct _EthernetSocketHttp_Config
+{
+    const EthernetSocketHttp_Route* routes;
+    uint8_t routesCount;
+
+    uint16_t maxRequest;  /**< Maximum bytes of a request, up to rx buffer - 1 */
+    uint8_t* scratch;     /**< maxRequest bytes, for requests that wrap around */
+} EthernetSocketHttp_Config;
+
+/**
+ * @ingroup functions
+ * This function answers all complete requests received by the client, and
+ * continues the static bodies not sent yet.
+ * @param[in] http The HTTP server configuration
+ * @param[in] handle The handle of the connection
+ * @return ETHERNETSOCKET_ERROR_NOT_CONNECTED if the handle is stale
+ * ETHERNETSOCKET_ERROR_WRONG_CONFIG if maxRequest doesn't fit into the
+ * receive buffer of the client, ETHERNETSOCKET_ERROR_OK otherwise.
+ */
+EthernetSocket_Error EthernetSocketHttp_process (const EthernetSocketHttp_Config* http,
+                                                 EthernetServerSocket_Handle handle);
+
+/**
+ * @ingroup functions
+ * This function writes a chunk of the response body, it can be called many
+ * times by a handler. HTTP/1.0 clients have no chunked encoding: they
+ * receive the bytes as they are, and the connection is closed after the
+ * response.
+ * @param[in] response The response of the handler
+ * @param[in] buffer The bytes to write
+ * @param[in] length The number of bytes
+ * @return ETHERNETSOCKET_ERROR_OK if all bytes are written, other errors
+ * otherwise (the connection is closed after the response).
+ */
+EthernetSocket_Error EthernetSocketHttp_write (EthernetSocketHttp_Response* response,
+                                               const uint8_t* buffer,
+                                               uint16_t length);
+
+/**
+ * @ingroup functions
+ * This function finds a header of the request.
+ * @param[in] request The request
+ * @param[in] name The header name, case insensitive
+ * @param[out] value The header value
+ * @param[out] length The number of bytes of the value
+ * @return TRUE if the header is present, FALSE otherwise.
+ */
+bool EthernetSocketHttp_header (const EthernetSocketHttp_Request* request,
+                                const char* name,
+                                const char** value,
+                                uint16_t* length);
+
+#endif // __OHILAB_ETHERNET_SOCKET_HTTP_H
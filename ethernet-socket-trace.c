@@ -0,0 +1,123 @@
+/*
+ * Ethernet Client/Server Socket with libohiboard
+ * Copyright (C) 2017-2018 A. C. Open Hardware Ideas Lab
+ *
+ * Authors:
+ *  Marco Giammarini <m.giammarini@warcomeb.it>
+ *  Matteo Civale
+ *  Gianluca Calignano <g.calignano97@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+
+#include "ethernet-socket-trace.h"
+
+#include <string.h>
+
+#ifdef ETHERNET_SOCKET_TRACE_SIZE
+
+typedef char EthernetSocket_check_trace_size[
+    ((ETHERNET_SOCKET_TRACE_SIZE <= 32768) &&
+     ((ETHERNET_SOCKET_TRACE_SIZE & (ETHERNET_SOCKET_TRACE_SIZE - 1)) == 0)) ? 1 : -1];
+
+typedef struct _EthernetSocket_TraceRecord
+{
+    uint32_t tick;
+    int32_t value;
+    uint8_t event;
+    uint8_t server;
+    uint8_t client;
+} EthernetSocket_TraceRecord;
+
+static EthernetSocket_TraceRecord EthernetSocket_traceRing[ETHERNET_SOCKET_TRACE_SIZE];
+
+static uint32_t EthernetSocket_traceCount = 0;   /**< Records since clear */
+
+static EthernetSocket_CurrentTick EthernetSocket_traceTick = 0;
+
+static void EthernetSocket_tracePut32 (uint8_t* buffer, uint32_t value)
+{
+    buffer[0] = value & 0xFF;
+    buffer[1] = (value >> 8) & 0xFF;
+    buffer[2] = (value >> 16) & 0xFF;
+    buffer[3] = (value >> 24) & 0xFF;
+}
+
+void EthernetSocket_traceInit (EthernetSocket_CurrentTick currentTick)
+{
+    EthernetSocket_traceTick = currentTick;
+}
+
+void EthernetSocket_trace (EthernetSocket_TraceEvent event,
+                           uint8_t server,
+                           uint8_t client,
+                           int32_t value)
+{
+    EthernetSocket_TraceRecord* record =
+            &EthernetSocket_traceRing[EthernetSocket_traceCount & (ETHERNET_SOCKET_TRACE_SIZE - 1)];
+
+    record->tick = (EthernetSocket_traceTick != 0) ? EthernetSocket_traceTick() : 0;
+    record->value = value;
+    record->event = event;
+    record->server = server;
+    record->client = client;
+
+    EthernetSocket_traceCount++;
+}
+
+void EthernetSocket_traceDump (EthernetSocket_TraceWrite write)
+{
+    uint8_t buffer[ETHERNETSOCKET_TRACE_RECORD_SIZE];
+    uint32_t count = EthernetSocket_traceCount;
+    uint32_t first = 0;
+
+    if (count > ETHERNET_SOCKET_TRACE_SIZE)
+        first = count - ETHERNET_SOCKET_TRACE_SIZE;
+
+    // Header
+    memcpy(buffer,ETHERNETSOCKET_TRACE_MAGIC,4);
+    buffer[4] = ETHERNETSOCKET_TRACE_VERSION;
+    buffer[5] = ETHERNETSOCKET_TRACE_RECORD_SIZE;
+    buffer[6] = (count - first) & 0xFF;
+    buffer[7] = ((count - first) >> 8) & 0xFF;
+    EthernetSocket_tracePut32(&buffer[8],count);
+    write(buffer,ETHERNETSOCKET_TRACE_HEADER_SIZE);
+
+    // Records, from the oldest
+    for (uint32_t i = first; i < count; ++i)
+    {
+        EthernetSocket_TraceRecord* record =
+                &EthernetSocket_traceRing[i & (ETHERNET_SOCKET_TRACE_SIZE - 1)];
+
+        EthernetSocket_tracePut32(&buffer[0],record->tick);
+        EthernetSocket_tracePut32(&buffer[4],(uint32_t)record->value);
+        buffer[8] = record->event;
+        buffer[9] = record->server;
+        buffer[10] = record->client;
+        buffer[11] = 0;
+        write(buffer,ETHERNETSOCKET_TRACE_RECORD_SIZE);
+    }
+}
+
+void EthernetSocket_traceClear (void)
+{
+    EthernetSocket_traceCount = 0;
+}
+
+#endif // ETHERNET_SOCKET_TRACE_SIZE
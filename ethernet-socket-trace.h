@@ -0,0 +1,133 @@
+/*
+ * Ethernet Client/Server Socket with libohiboard
+ * Copyright (C) 2017-2018 A. C. Open Hardware Ideas Lab
+ *
+ * Authors:
+ *  Marco Giammarini <m.giammarini@warcomeb.it>
+ *  Matteo Civale
+ *  Gianluca Calignano <g.calignano97@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TRACE_H
+#define __OHILAB_ETHERNET_SOCKET_TRACE_H
+
+#include "ethernet-socket.h"
+
+/*
+ * The trace is enabled defining into board.h the number of records of the
+ * trace ring (a power of two), for example:
+ *
+ *   #define ETHERNET_SOCKET_TRACE_SIZE 256
+ *
+ * Every record takes 12 bytes. When the label is not defined all trace
+ * code is removed.
+ */
+
+/**
+ * @ingroup functions
+ * Events saved into the trace ring.
+ */
+typedef enum
+{
+    ///New client connected
+    ETHERNETSOCKET_TRACE_ACCEPT = 1,
+    ///New client refused, value is the lwIP error
+    ETHERNETSOCKET_TRACE_REJECT,
+    ///Data received from lwIP, value is the number of bytes
+    ETHERNETSOCKET_TRACE_RECEIVE,
+    ///Data read by the application, value is the number of bytes
+    ETHERNETSOCKET_TRACE_READ,
+    ///Data written by the application, value is the number of bytes
+    ETHERNETSOCKET_TRACE_WRITE,
+    ///Data sent with tcp_output
+    ETHERNETSOCKET_TRACE_OUTPUT,
+    ///Error from lwIP, value is the lwIP error
+    ETHERNETSOCKET_TRACE_ERROR,
+    ///Client disconnected
+    ETHERNETSOCKET_TRACE_CLOSE,
+} EthernetSocket_TraceEvent;
+
+#define ETHERNETSOCKET_TRACE_MAGIC          "ESTR"
+#define ETHERNETSOCKET_TRACE_VERSION        1
+#define ETHERNETSOCKET_TRACE_HEADER_SIZE    12
+#define ETHERNETSOCKET_TRACE_RECORD_SIZE    12
+
+/**
+ * @ingroup functions
+ * Callback used to dump the trace, for example a UART or socket write.
+ */
+typedef void (*EthernetSocket_TraceWrite) (const uint8_t* data,
+                                           uint16_t length);
+
+#ifdef ETHERNET_SOCKET_TRACE_SIZE
+
+/**
+ * @ingroup functions
+ * This function saves the callback used to timestamp the records, it is
+ * called by the socket init functions.
+ * @param[in] currentTick Callback for basic timing
+ */
+void EthernetSocket_traceInit (EthernetSocket_CurrentTick currentTick);
+
+/**
+ * @ingroup functions
+ * This function saves a record into the trace ring, the oldest record is
+ * overwritten when the ring is full.
+ * @param[in] event The event
+ * @param[in] server The server socket number
+ * @param[in] client The client number
+ * @param[in] value Bytes or error code of the event
+ */
+void EthernetSocket_trace (EthernetSocket_TraceEvent event,
+                           uint8_t server,
+                           uint8_t client,
+                           int32_t value);
+
+/**
+ * @ingroup functions
+ * This function writes the trace, from the oldest record to the newest.
+ * It writes an header of ETHERNETSOCKET_TRACE_HEADER_SIZE bytes (magic,
+ * version, record size, number of records and number of records saved
+ * since the last clear) and then the records, all little endian, as read
+ * by tools/ethernet-socket-trace.py.
+ * @param[in] write The callback that writes the bytes
+ */
+void EthernetSocket_traceDump (EthernetSocket_TraceWrite write);
+
+/**
+ * @ingroup functions
+ * This function removes all records from the trace ring.
+ */
+void EthernetSocket_traceClear (void);
+
+#define ETHERNETSOCKET_TRACE_INIT(currentTick) \
+    EthernetSocket_traceInit(currentTick)
+#define ETHERNETSOCKET_TRACE(event, server, client, value) \
+    EthernetSocket_trace(event, server, client, value)
+
+#else
+
+#define ETHERNETSOCKET_TRACE_INIT(currentTick)
+#define ETHERNETSOCKET_TRACE(event, server, client, value)
+
+#endif
+
+#endif // __OHILAB_ETHERNET_SOCKET_TRACE_H
@@ -0,0 +1,181 @@
+/*
+ * Ethernet Client/Server Socket with libohiboard
+ * Copyright (C) 2017-2018 A. C. Open Hardware Ideas Lab
+ *
+ * Authors:
+ *  Marco Giammarini <m.giammarini@warcomeb.it>
+ *  Matteo Civale
+ *  Gianluca Calignano <g.calignano97@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TRANSPORT_H
+#define __OHILAB_ETHERNET_SOCKET_TRANSPORT_H
+
+#include "ethernet-socket.h"
+
+/*
+ * The sockets use the lwIP raw TCP API, or the lwIP altcp API when
+ * LWIP_ALTCP is enabled into lwipopts.h. With altcp a server can run over
+ * TLS (LWIP_ALTCP_TLS and LWIP_ALTCP_TLS_MBEDTLS), see
+ * EthernetServerSocket_setTls().
+ *
+ * A TLS handshake takes hundreds of milliseconds of CPU, so reconnecting
+ * clients should resume their previous session. It is done by the mbedTLS
+ * port of lwIP, enabled into lwipopts.h with a small cache:
+ *
+ *   #define ALTCP_MBEDTLS_USE_SESSION_CACHE             1
+ *   #define ALTCP_MBEDTLS_SESSION_CACHE_SIZE            4
+ *   #define ALTCP_MBEDTLS_SESSION_CACHE_TIMEOUT_SECONDS (60 * 60)
+ *   #define ALTCP_MBEDTLS_USE_SESSION_TICKETS           1
+ *
+ * The session cache keeps the last sessions into the device, the session
+ * tickets keep them (encrypted) into the clients.
+ */
+
+#if LWIP_ALTCP
+
+#include "lwip/altcp.h"
+#include "lwip/altcp_tcp.h"
+#if LWIP_ALTCP_TLS
+#include "lwip/altcp_tls.h"
+#include "lwip/apps/altcp_tls_mbedtls_opts.h"
+#if LWIP_ALTCP_TLS_MBEDTLS && \
+    !ALTCP_MBEDTLS_USE_SESSION_CACHE && !ALTCP_MBEDTLS_USE_SESSION_TICKETS
+#warning "TLS sessions are not resumed: every reconnection does a full handshake!"
+#endif
+#endif
+
+typedef struct altcp_pcb EthernetSocket_Pcb;
+
+#define EthernetSocket_tcpArg      altcp_arg
+#define EthernetSocket_tcpAccept   altcp_accept
+#define EthernetSocket_tcpRecv     altcp_recv
+#define EthernetSocket_tcpSent     altcp_sent
+#define EthernetSocket_tcpErr      altcp_err
+#define EthernetSocket_tcpPoll     altcp_poll
+#define EthernetSocket_tcpBind     altcp_bind
+#define EthernetSocket_tcpListen   altcp_listen
+#define EthernetSocket_tcpSetprio  altcp_setprio
+#define EthernetSocket_tcpRecved   altcp_recved
+#define EthernetSocket_tcpSndbuf   altcp_sndbuf
+#define EthernetSocket_tcpWrite    altcp_write
+#define EthernetSocket_tcpOutput   altcp_output
+#define EthernetSocket_tcpClose    altcp_close
+#define EthernetSocket_tcpAbort    altcp_abort
+
+/*
+ * Create a pcb: plain TCP when tls is NULL, otherwise TLS with the
+ * selected configuration (struct altcp_tls_config).
+ */
+static inline EthernetSocket_Pcb* EthernetSocket_tcpNew (void* tls)
+{
+    altcp_allocator_t allocator = { altcp_tcp_alloc, NULL };
+#if LWIP_ALTCP_TLS
+    if (tls != NULL)
+    {
+        allocator.alloc = altcp_tls_alloc;
+        allocator.arg = tls;
+    }
+#else
+    if (tls != NULL)
+        return NULL;
+#endif
+    return altcp_new_ip_type(&allocator, IPADDR_TYPE_ANY);
+}
+
+/*
+ * The altcp keepalive (from lwIP 2.2) needs LWIP_TCP_KEEPALIVE into
+ * lwipopts.h: without it the servers have no keepalive.
+ */
+#define ETHERNET_SOCKET_KEEPALIVE  LWIP_TCP_KEEPALIVE
+
+#if LWIP_TCP_KEEPALIVE
+/*
+ * Enable keepalive probes, times in milliseconds.
+ */
+static inline void EthernetSocket_tcpKeepalive (EthernetSocket_Pcb* pcb,
+                                                uint32_t idle,
+                                                uint32_t interval,
+                                                uint32_t count)
+{
+    altcp_keepalive_enable(pcb, idle, interval, count);
+}
+#endif
+
+#else
+
+typedef struct tcp_pcb EthernetSocket_Pcb;
+
+#define EthernetSocket_tcpArg      tcp_arg
+#define EthernetSocket_tcpAccept   tcp_accept
+#define EthernetSocket_tcpRecv     tcp_recv
+#define EthernetSocket_tcpSent     tcp_sent
+#define EthernetSocket_tcpErr      tcp_err
+#define EthernetSocket_tcpPoll     tcp_poll
+#define EthernetSocket_tcpBind     tcp_bind
+#define EthernetSocket_tcpListen   tcp_listen
+#define EthernetSocket_tcpSetprio  tcp_setprio
+#define EthernetSocket_tcpRecved   tcp_recved
+#define EthernetSocket_tcpSndbuf   tcp_sndbuf
+#define EthernetSocket_tcpWrite    tcp_write
+#define EthernetSocket_tcpOutput   tcp_output
+#define EthernetSocket_tcpClose    tcp_close
+#define EthernetSocket_tcpAbort    tcp_abort
+
+/*
+ * Create a pcb, TLS is not available without altcp.
+ */
+static inline EthernetSocket_Pcb* EthernetSocket_tcpNew (void* tls)
+{
+    if (tls != NULL)
+        return NULL;
+    return tcp_new();
+}
+
+/*
+ * The raw pcb has always the idle time, the interval and the count need
+ * LWIP_TCP_KEEPALIVE into lwipopts.h (otherwise lwIP uses its defaults).
+ */
+#define ETHERNET_SOCKET_KEEPALIVE  1
+
+/*
+ * Enable keepalive probes, times in milliseconds.
+ */
+static inline void EthernetSocket_tcpKeepalive (EthernetSocket_Pcb* pcb,
+                                                uint32_t idle,
+                                                uint32_t interval,
+                                                uint32_t count)
+{
+    ip_set_option(pcb, SOF_KEEPALIVE);
+    pcb->keep_idle = idle;
+#if LWIP_TCP_KEEPALIVE
+    pcb->keep_intvl = interval;
+    pcb->keep_cnt = count;
+#else
+    // Not configurable, see the server configuration
+    (void)interval;
+    (void)count;
+#endif
+}
+
+#endif // LWIP_ALTCP
+
+#endif // __OHILAB_ETHERNET_SOCKET_TRANSPORT_H
@@ -34,6 +34,22 @@
  *
  * @section changelog ChangeLog
  *
+ * @li v2.0.0 of 2026/10/18 - Server sockets described by a compile-time
+ * table, client handles, transmit buffers and scheduling, TLS, keepalive,
+ * event trace, wait API, command dispatcher and HTTP server.
+ * Migration from v1:
+ *   - ETHERNET_MAX_SOCKET_SERVER, ETHERNET_MAX_LISTEN_CLIENT and
+ *     ETHERNET_MAX_SOCKET_BUFFER are replaced by ETHERNET_SERVER_TABLE in
+ *     board.h, one SERVER(name, clients, rx, tx, .port = ...) line for
+ *     each server (ETHERNET_MAX_SOCKET_CLIENT is still required);
+ *   - the buffer dimensions are powers of two, and the buffers hold one
+ *     byte less than their dimension;
+ *   - EthernetServerSocket_connect(number) takes the port from the table,
+ *     the number is ETHERNETSERVERSOCKET_SERVER_<name>;
+ *   - the loops over the clients use ETHERNETSERVERSOCKET_CLIENTS_<name>,
+ *     and the new handle functions skip the checks of every call;
+ *   - received bytes are acknowledged when they are read, so a client
+ *     that is not read stops sending.
  * @li v1.0.0 of 2018/08/24 - First release
  *
  * @section library External Library
@@ -63,14 +79,41 @@
  *  #define WARCOMEB_TIMER_CALLBACK      5
  *
  *  //macros for ethernet-serversocket module
- *  #define ETHERNET_MAX_LISTEN_CLIENT 5
- *  #define ETHERNET_MAX_SOCKET_BUFFER 1023
  *  #define ETHERNET_MAX_SOCKET_CLIENT 5
- *  #define ETHERNET_MAX_SOCKET_SERVER 5
+ *
+ *  //One line for each server socket:
+ *  //SERVER(name, clients, rx buffer, tx buffer, options...)
+ *  #define ETHERNET_SERVER_TABLE(SERVER)                               \
+ *      SERVER(ECHO,    5, 1024, 0,    .port = 23)                       \
+ *      SERVER(CONTROL, 2, 256,  256,  .port = 5000,                     \
+ *                                     .priority = TCP_PRIO_MAX,         \
+ *                                     .keepIdle = 5000,                 \
+ *                                     .txPolicy = ETHERNETSERVERSOCKET_TXPOLICY_ROUND_ROBIN) \
+ *      SERVER(LOG,     1, 2048, 4096, .port = 5001,                     \
+ *                                     .txPolicy = ETHERNETSERVERSOCKET_TXPOLICY_ROUND_ROBIN)
  *
  * @endcode
  * <BR>
  *
+ * Every line of @a ETHERNET_SERVER_TABLE describes one server socket: the
+ * number of clients and the receive and transmit buffer dimensions (powers
+ * of two, the transmit one can be 0 when not used) are used to allocate
+ * static memory for that server only, while the options are the fields of
+ * #EthernetServerSocket_Config (the port is mandatory).
+ * The servers with round robin or deficit transmit policy share the lwIP
+ * send space between all their clients, so a bulk transfer doesn't stall
+ * the other connections.
+ * The servers with a transmit buffer accept every write that fits into it
+ * and send it when lwIP has space, so the application doesn't retry the
+ * partial writes; txHighWater and txWater tell when a client is slow.
+ * The servers with keepIdle send keepalive probes to idle clients, and
+ * free the slots of the clients that don't answer (power or cable lost).
+ * keepInterval and keepCount need LWIP_TCP_KEEPALIVE into lwipopts.h, and
+ * with altcp keepIdle too: without it a table that sets them doesn't build.
+ * The server is identified by ETHERNETSERVERSOCKET_SERVER_<name> and the
+ * number of its clients by ETHERNETSERVERSOCKET_CLIENTS_<name>.
+ * <BR>
+ *
  * While the main.c is developed only to test this library so there is small
  * echo algorithm in while(1) <BR>
  * that if neither a or b or c character is received
@@ -92,6 +135,8 @@
  *      uint32_t fout;
  *      uint32_t foutBus;
  *      Clock_State clockState;
+ *      uint8_t data;
+ *      int16_t available;
  *
  *      //Declare EthernetSocket_Config struct
  *      EthernetSocket_Config ethernetSocketConfig=
@@ -99,6 +144,7 @@
  *          .timeout = 3000,
  *          .delay = Timer_delay,
  *          .currentTick = Timer_currentTick,
+ *          .idle = Board_idle, //For example a WFI until next interrupt
  *      };
  *
  *      //Declaring ClockConfig struct
@@ -158,23 +204,28 @@
  *      //Ethernet server socket initialization
  *      Ethernet_networkConfig(&nettest, &netConfig);
  *
+ *      //Open the echo server socket
+ *      EthernetServerSocket_init(&ethernetSocketConfig);
+ *      EthernetServerSocket_connect(ETHERNETSERVERSOCKET_SERVER_ECHO);
+ *
  *      //Turn the red LED on, now we can send a character to
  *      //the opened socket
  *      Gpio_clear(GPIO_PINS_PTB22);
  *
  *     while(1)
  *     {
- *         sys_check_timeouts();
- *         //A small delay
- *         Timer_delay(100);
+ *         //Run lwIP and sleep until a client event, at most 100 ms
+ *         if (EthernetServerSocket_wait(100) == FALSE)
+ *             continue;
  *
  *         //checking all clients for incoming data
- *         for (uint8_t j = 0; j < ETHERNET_MAX_LISTEN_CLIENT; ++j)
+ *         for (uint8_t j = 0; j < ETHERNETSERVERSOCKET_CLIENTS_ECHO; ++j)
  *         {
- *             if (EthernetServerSocket_available(0,j)>0)
+ *             while ((EthernetServerSocket_available(ETHERNETSERVERSOCKET_SERVER_ECHO,j,&available) == ETHERNETSOCKET_ERROR_OK) &&
+ *                    (available > 0))
  *             {
  *                  //Read the data from the j client
- *                  EthernetServerSocket_read(0,j,&data);
+ *                  EthernetServerSocket_read(ETHERNETSERVERSOCKET_SERVER_ECHO,j,&data);
  *
  *                  //A small echo algorithm that if neither
  *                  //a or b or c character is received the server replies
@@ -183,13 +234,13 @@
  *                  switch(data)
  *                  {
  *                  case 'a':
- *                      EthernetServerSocket_write(0,j,'A');
+ *                      EthernetServerSocket_write(ETHERNETSERVERSOCKET_SERVER_ECHO,j,'A');
  *                      break;
  *                  case 'b':
- *                      EthernetServerSocket_write(0,j,'B');
+ *                      EthernetServerSocket_write(ETHERNETSERVERSOCKET_SERVER_ECHO,j,'B');
  *                      break;
  *                  case 'c':
- *                      EthernetServerSocket_write(0,j,'C');
+ *                      EthernetServerSocket_write(ETHERNETSERVERSOCKET_SERVER_ECHO,j,'C');
  *                      break;
  *                  }
  *              }
@@ -210,11 +261,11 @@
 #ifndef __OHILAB_ETHERNET_SOCKET_H
 #define __OHILAB_ETHERNET_SOCKET_H
 
-#define OHILAB_ETHERNET_SOCKET_LIBRARY_VERSION     "1.0.0"
-#define OHILAB_ETHERNET_SOCKET_LIBRARY_VERSION_M   1
+#define OHILAB_ETHERNET_SOCKET_LIBRARY_VERSION     "2.0.0"
+#define OHILAB_ETHERNET_SOCKET_LIBRARY_VERSION_M   2
 #define OHILAB_ETHERNET_SOCKET_LIBRARY_VERSION_m   0
 #define OHILAB_ETHERNET_SOCKET_LIBRARY_VERSION_bug 0
-#define OHILAB_ETHERNET_SOCKET_LIBRARY_TIME        1535124886
+#define OHILAB_ETHERNET_SOCKET_LIBRARY_TIME        1792324800
 
 #include "libohiboard.h"
 
@@ -233,14 +284,8 @@
 #ifndef ETHERNET_MAX_SOCKET_CLIENT
 #error "Socket Client: maximum number not defined!"
 #endif
-#ifndef ETHERNET_MAX_SOCKET_SERVER
-#error "Socket Server: maximum number not defined!"
-#endif
-#ifndef ETHERNET_MAX_LISTEN_CLIENT
-#error "Socket Server: maximum number of client per server not defined!"
-#endif
-#ifndef ETHERNET_MAX_SOCKET_BUFFER
-#error "Socket Client: maximum buffer dimension not defined!"
+#ifndef ETHERNET_SERVER_TABLE
+#error "Socket Server: server configuration table not defined!"
 #endif
 
 /**
@@ -287,15 +332,21 @@ typedef enum
     ETHERNETSOCKET_ERROR_BUFFER_NO_DATA,
     ///Open fail
     ETHERNETSOCKET_ERROR_OPEN_FAIL,
+    ///Configuration not usable with the server
+    ETHERNETSOCKET_ERROR_WRONG_CONFIG,
 } EthernetSocket_Error;
 
 typedef uint32_t (*EthernetSocket_CurrentTick) (void);
 typedef void (*EthernetSocket_Delay) (uint32_t);
+typedef void (*EthernetSocket_Idle) (uint32_t);
+typedef void (*EthernetSocket_Wake) (void);
 
 typedef struct _EthernetSocket_Config
 {
     uint32_t (*currentTick) (void);            /**< Callback for basic timing */
     void (*delay) (uint32_t);                /**< Callback for blocking delay */
+    void (*idle) (uint32_t);   /**< Callback to sleep at most ms, optional */
+    void (*wake) (void);      /**< Callback at every socket event, optional */
 
     uint32_t timeout;            /**< Read and write timeout operations in ms */
 } EthernetSocket_Config;
@@ -0,0 +1,311 @@
+/*
+ * Fake lwIP used by the tests, see fake-lwip.h.
+ */
+
+#include "fake-lwip.h"
+
+#if LWIP_ALTCP
+#include "lwip/altcp.h"
+#include "lwip/altcp_tcp.h"
+#if LWIP_ALTCP_TLS
+#include "lwip/altcp_tls.h"
+#endif
+#endif
+
+int Test_failures = 0;
+
+uint32_t Fake_tick = 0;
+uint32_t Fake_sleeptime = 0xFFFFFFFF;
+uint32_t Fake_pbufFree = 0;
+uint32_t Fake_pbufs = 0;
+
+void (*Fake_txWater) (uint32_t handle, uint8_t high) = NULL;
+
+static struct tcp_pcb Fake_pcbs[FAKE_PCBS];
+
+void Test_txWater (uint32_t handle, uint8_t high)
+{
+    if (Fake_txWater != NULL)
+        Fake_txWater(handle,high);
+}
+
+uint32_t Fake_currentTick (void)
+{
+    return Fake_tick;
+}
+
+struct tcp_pcb* tcp_new (void)
+{
+    for (int i = 0; i < FAKE_PCBS; ++i)
+    {
+        if (!Fake_pcbs[i].used)
+        {
+            memset(&Fake_pcbs[i],0,sizeof(struct tcp_pcb));
+            Fake_pcbs[i].used = 1;
+            Fake_pcbs[i].sndbuf = FAKE_SNDBUF;
+            Fake_pcbs[i].prio = TCP_PRIO_NORMAL;
+            return &Fake_pcbs[i];
+        }
+    }
+    return NULL;
+}
+
+err_t tcp_bind (struct tcp_pcb *pcb, const void *ipaddr, u16_t port)
+{
+    pcb->port = port;
+    return ERR_OK;
+}
+
+struct tcp_pcb* tcp_listen (struct tcp_pcb *pcb)
+{
+    pcb->listening = 1;
+    return pcb;
+}
+
+void tcp_arg (struct tcp_pcb *pcb, void *arg)            { pcb->arg = arg; }
+void tcp_setprio (struct tcp_pcb *pcb, u8_t prio)        { pcb->prio = prio; }
+void tcp_accept (struct tcp_pcb *pcb, tcp_accept_fn fn)  { pcb->accept = fn; }
+void tcp_recv (struct tcp_pcb *pcb, tcp_recv_fn fn)      { pcb->recv = fn; }
+void tcp_sent (struct tcp_pcb *pcb, tcp_sent_fn fn)      { pcb->sent = fn; }
+void tcp_err (struct tcp_pcb *pcb, tcp_err_fn fn)        { pcb->err = fn; }
+void tcp_recved (struct tcp_pcb *pcb, u16_t len)         { pcb->recved += len; }
+u16_t tcp_sndbuf (struct tcp_pcb *pcb)                   { return pcb->sndbuf; }
+
+void tcp_poll (struct tcp_pcb *pcb, tcp_poll_fn fn, u8_t interval)
+{
+    pcb->poll = fn;
+    pcb->pollInterval = interval;
+}
+
+err_t tcp_close (struct tcp_pcb *pcb)
+{
+    pcb->closed = 1;
+    return ERR_OK;
+}
+
+void tcp_abort (struct tcp_pcb *pcb)
+{
+    pcb->aborted = 1;
+    pcb->used = 0;
+}
+
+err_t tcp_write (struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags)
+{
+    if ((len > pcb->sndbuf) || pcb->closed)
+        return ERR_MEM;
+    if (pcb->outLength + len >= sizeof(pcb->out))
+        return ERR_MEM;
+
+    memcpy(&pcb->out[pcb->outLength],dataptr,len);
+    pcb->outLength += len;
+    pcb->out[pcb->outLength] = 0;
+    pcb->sndbuf -= len;
+    return ERR_OK;
+}
+
+err_t tcp_output (struct tcp_pcb *pcb)
+{
+    pcb->outputs++;
+    return ERR_OK;
+}
+
+u8_t pbuf_free (struct pbuf *p)
+{
+    u8_t count = 0;
+
+    while (p != NULL)
+    {
+        struct pbuf* next = p->next;
+        free(p);
+        Fake_pbufFree++;
+        Fake_pbufs--;
+        count++;
+        p = next;
+    }
+    return count;
+}
+
+void pbuf_cat (struct pbuf *head, struct pbuf *tail)
+{
+    for (; head->next != NULL; head = head->next)
+        head->tot_len += tail->tot_len;
+    head->tot_len += tail->tot_len;
+    head->next = tail;
+}
+
+u16_t pbuf_copy_partial (const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset)
+{
+    u16_t copied = 0;
+
+    for (; (buf != NULL) && (copied < len); buf = buf->next)
+    {
+        if (offset >= buf->len)
+        {
+            offset -= buf->len;
+            continue;
+        }
+        u16_t length = buf->len - offset;
+        if (length > (len - copied))
+            length = len - copied;
+        memcpy((u8_t*)dataptr + copied,(u8_t*)buf->payload + offset,length);
+        copied += length;
+        offset = 0;
+    }
+    return copied;
+}
+
+struct pbuf* pbuf_free_header (struct pbuf *q, u16_t size)
+{
+    while ((q != NULL) && (size > 0))
+    {
+        if (size >= q->len)
+        {
+            struct pbuf* p = q;
+            size -= q->len;
+            q = q->next;
+            p->next = NULL;
+            pbuf_free(p);
+        }
+        else
+        {
+            q->payload = (u8_t*)q->payload + size;
+            q->len -= size;
+            q->tot_len -= size;
+            size = 0;
+        }
+    }
+    return q;
+}
+
+#if LWIP_ALTCP
+struct tcp_pcb* altcp_new_ip_type (altcp_allocator_t *allocator, u8_t ip_type)
+{
+    return allocator->alloc(allocator->arg,ip_type);
+}
+
+struct tcp_pcb* altcp_tcp_alloc (void *arg, u8_t ip_type)
+{
+    return tcp_new();
+}
+
+void altcp_keepalive_enable (struct tcp_pcb *pcb, u32_t idle, u32_t intvl, u32_t count)
+{
+    ip_set_option(pcb,SOF_KEEPALIVE);
+    pcb->keep_idle = idle;
+    pcb->keep_intvl = intvl;
+    pcb->keep_cnt = count;
+}
+
+#if LWIP_ALTCP_TLS
+struct tcp_pcb* altcp_tls_alloc (void *arg, u8_t ip_type)
+{
+    struct tcp_pcb* pcb = tcp_new();
+
+    if (pcb != NULL)
+        pcb->tls = arg;
+    return pcb;
+}
+#endif
+#endif
+
+void sys_check_timeouts (void)
+{
+}
+
+u32_t sys_timeouts_sleeptime (void)
+{
+    return Fake_sleeptime;
+}
+
+struct tcp_pcb* Fake_listener (u16_t port)
+{
+    for (int i = 0; i < FAKE_PCBS; ++i)
+    {
+        if (Fake_pcbs[i].used && Fake_pcbs[i].listening && !Fake_pcbs[i].closed &&
+            (Fake_pcbs[i].port == port))
+            return &Fake_pcbs[i];
+    }
+    return NULL;
+}
+
+struct tcp_pcb* Fake_connect (u16_t port)
+{
+    struct tcp_pcb* listener = Fake_listener(port);
+    struct tcp_pcb* pcb = tcp_new();
+
+    if ((listener == NULL) || (pcb == NULL))
+        return NULL;
+
+    pcb->port = port;
+    pcb->tls = listener->tls;
+    if (listener->accept(listener->arg,pcb,ERR_OK) != ERR_OK)
+    {
+        pcb->used = 0;
+        return NULL;
+    }
+    return pcb;
+}
+
+err_t Fake_send (struct tcp_pcb* pcb, const void* data, u16_t length, u16_t chunk)
+{
+    struct pbuf* first = NULL;
+    struct pbuf* last = NULL;
+
+    // Like lwIP, the pbufs belong to the receive callback
+    for (u16_t offset = 0; offset < length; offset += chunk)
+    {
+        u16_t len = ((length - offset) < chunk) ? (length - offset) : chunk;
+        struct pbuf* p = malloc(sizeof(struct pbuf) + len);
+
+        p->payload = p + 1;
+        memcpy(p->payload,(const uint8_t*)data + offset,len);
+        p->len = len;
+        p->tot_len = length - offset;
+        p->next = NULL;
+        Fake_pbufs++;
+        if (last != NULL)
+            last->next = p;
+        else
+            first = p;
+        last = p;
+    }
+    return pcb->recv(pcb->arg,pcb,first,ERR_OK);
+}
+
+err_t Fake_fin (struct tcp_pcb* pcb)
+{
+    return pcb->recv(pcb->arg,pcb,NULL,ERR_OK);
+}
+
+err_t Fake_ack (struct tcp_pcb* pcb, u16_t length)
+{
+    pcb->sndbuf += length;
+    if (pcb->sent == NULL)
+        return ERR_OK;
+    return pcb->sent(pcb->arg,pcb,length);
+}
+
+err_t Fake_poll (struct tcp_pcb* pcb)
+{
+    if (pcb->poll == NULL)
+        return ERR_OK;
+    return pcb->poll(pcb->arg,pcb);
+}
+
+void Fake_error (struct tcp_pcb* pcb, err_t err)
+{
+    pcb->used = 0;
+    if (pcb->err != NULL)
+        pcb->err(pcb->arg,err);
+}
+
+const char* Fake_output (struct tcp_pcb* pcb)
+{
+    return (const char*)pcb->out;
+}
+
+void Fake_take (struct tcp_pcb* pcb)
+{
+    pcb->outLength = 0;
+    pcb->out[0] = 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * Fake lwIP used by the tests: it records what the library does on every
+ * pcb and lets the tests play the part of the remote client.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_FAKE_LWIP_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_FAKE_LWIP_H
+
+#include <stdlib.h>
+
+#include "libohiboard.h"
+#include "test.h"
+
+#define FAKE_SNDBUF  4096
+#define FAKE_PCBS    64
+
+extern uint32_t Fake_tick;
+extern uint32_t Fake_sleeptime;
+extern uint32_t Fake_pbufFree;
+extern uint32_t Fake_pbufs;        /**< pbufs given and not freed yet */
+
+/* Called by Test_txWater(), the txWater callback of the test table */
+extern void (*Fake_txWater) (uint32_t handle, uint8_t high);
+
+uint32_t Fake_currentTick (void);
+
+/* The listening pcb of the port, NULL if there is not */
+struct tcp_pcb* Fake_listener (u16_t port);
+
+/* A new client connects to the port, NULL if the server refused it */
+struct tcp_pcb* Fake_connect (u16_t port);
+
+/* The client sends bytes, into pbufs of chunk bytes at most */
+err_t Fake_send (struct tcp_pcb* pcb, const void* data, u16_t length, u16_t chunk);
+
+/* The client closes its side of the connection */
+err_t Fake_fin (struct tcp_pcb* pcb);
+
+/* The client acknowledges bytes */
+err_t Fake_ack (struct tcp_pcb* pcb, u16_t length);
+
+/* lwIP calls the poll callback */
+err_t Fake_poll (struct tcp_pcb* pcb);
+
+/* lwIP drops the connection, the pcb is freed */
+void Fake_error (struct tcp_pcb* pcb, err_t err);
+
+/* Bytes written to the client and not yet taken with Fake_take() */
+const char* Fake_output (struct tcp_pcb* pcb);
+
+/* Forget the bytes written to the client */
+void Fake_take (struct tcp_pcb* pcb);
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_FAKE_LWIP_H
@@ -0,0 +1,31 @@
+/*
+ * Board configuration of the tests.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_BOARD_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_BOARD_H
+
+#include <stdint.h>
+
+void Test_txWater (uint32_t handle, uint8_t high);
+
+#define ETHERNET_MAX_SOCKET_CLIENT 5
+
+/* The options that need LWIP_TCP_KEEPALIVE, see the check of the Makefile */
+#ifdef TEST_KEEPALIVE_OPTIONS
+#define TEST_KEEPALIVE .keepIdle = 5000, .keepInterval = 500
+#else
+#define TEST_KEEPALIVE .keepIdle = 5000
+#endif
+
+#define ETHERNET_SERVER_TABLE(SERVER)                                      \
+    SERVER(ECHO,  2, 64,  0,   .port = 23,                                 \
+                               TEST_KEEPALIVE)                             \
+    SERVER(QUEUE, 2, 256, 128, .port = 5000,                               \
+                               .txPolicy = ETHERNETSERVERSOCKET_TXPOLICY_DEFICIT, \
+                               .quantum = 16,                              \
+                               .txHighWater = 64,                          \
+                               .txWater = Test_txWater)                    \
+    SERVER(WEB,   2, 512, 0,   .port = 80)
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_BOARD_H
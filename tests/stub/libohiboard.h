@@ -0,0 +1,118 @@
+/*
+ * Host stub of libohiboard and of the lwIP raw TCP API, used only by the
+ * tests: the functions are implemented by tests/fake-lwip.c. The altcp
+ * API, with LWIP_ALTCP, is into stub/lwip.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_LIBOHIBOARD_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_LIBOHIBOARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t bool;
+#define TRUE  1
+#define FALSE 0
+
+typedef int8_t err_t;
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+
+#define ERR_OK    0
+#define ERR_MEM   -1
+#define ERR_BUF   -2
+#define ERR_VAL   -6
+#define ERR_ABRT  -13
+#define ERR_RST   -14
+#define ERR_CLSD  -15
+
+#ifndef LWIP_ALTCP
+#define LWIP_ALTCP           0
+#endif
+#ifndef LWIP_TCP_KEEPALIVE
+#define LWIP_TCP_KEEPALIVE   1
+#endif
+#define SOF_KEEPALIVE        0x08
+#define TCP_PRIO_MIN         1
+#define TCP_PRIO_NORMAL      64
+#define TCP_PRIO_MAX         127
+#define TCP_WRITE_FLAG_COPY  0x01
+#define TCP_WRITE_FLAG_MORE  0x02
+#define TCP_MSS              536
+#define TCP_TMR_INTERVAL     250
+#define IP_ADDR_ANY          ((void*)0)
+
+struct pbuf
+{
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+struct tcp_pcb;
+
+typedef err_t (*tcp_accept_fn) (void *arg, struct tcp_pcb *newpcb, err_t err);
+typedef err_t (*tcp_recv_fn) (void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn) (void *arg, struct tcp_pcb *tpcb, u16_t len);
+typedef err_t (*tcp_poll_fn) (void *arg, struct tcp_pcb *tpcb);
+typedef void (*tcp_err_fn) (void *arg, err_t err);
+
+struct tcp_pcb
+{
+    u8_t prio;
+    u8_t so_options;
+    u32_t keep_idle;
+    u32_t keep_intvl;
+    u32_t keep_cnt;
+
+    void *arg;
+    tcp_accept_fn accept;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_err_fn err;
+    tcp_poll_fn poll;
+    u8_t pollInterval;
+
+    u16_t port;
+    void *tls;
+    u8_t used;
+    u8_t listening;
+    u8_t closed;
+    u8_t aborted;
+    u16_t sndbuf;
+    u32_t recved;
+    u32_t outputs;
+    u32_t outLength;
+    u8_t out[8192];
+};
+
+struct tcp_pcb *tcp_new (void);
+err_t tcp_bind (struct tcp_pcb *pcb, const void *ipaddr, u16_t port);
+struct tcp_pcb *tcp_listen (struct tcp_pcb *pcb);
+void tcp_arg (struct tcp_pcb *pcb, void *arg);
+void tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
+void tcp_accept (struct tcp_pcb *pcb, tcp_accept_fn accept);
+void tcp_recv (struct tcp_pcb *pcb, tcp_recv_fn recv);
+void tcp_sent (struct tcp_pcb *pcb, tcp_sent_fn sent);
+void tcp_poll (struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval);
+void tcp_err (struct tcp_pcb *pcb, tcp_err_fn err);
+void tcp_recved (struct tcp_pcb *pcb, u16_t len);
+err_t tcp_close (struct tcp_pcb *pcb);
+void tcp_abort (struct tcp_pcb *pcb);
+err_t tcp_write (struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output (struct tcp_pcb *pcb);
+u16_t tcp_sndbuf (struct tcp_pcb *pcb);
+u8_t pbuf_free (struct pbuf *p);
+void pbuf_cat (struct pbuf *head, struct pbuf *tail);
+u16_t pbuf_copy_partial (const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset);
+struct pbuf* pbuf_free_header (struct pbuf *q, u16_t size);
+
+void sys_check_timeouts (void);
+u32_t sys_timeouts_sleeptime (void);
+
+#define ip_set_option(pcb, opt) ((pcb)->so_options = (u8_t)((pcb)->so_options | (opt)))
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_LIBOHIBOARD_H
@@ -0,0 +1,42 @@
+/*
+ * Host stub of the lwIP altcp API, used only by the tests: an altcp pcb
+ * is a pcb of the fake lwIP, see tests/fake-lwip.c.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_H
+
+#include "libohiboard.h"
+
+#define altcp_pcb  tcp_pcb
+
+#define IPADDR_TYPE_ANY  46
+
+typedef struct tcp_pcb* (*altcp_new_fn) (void *arg, u8_t ip_type);
+
+typedef struct altcp_allocator_s
+{
+    altcp_new_fn alloc;
+    void *arg;
+} altcp_allocator_t;
+
+struct tcp_pcb *altcp_new_ip_type (altcp_allocator_t *allocator, u8_t ip_type);
+void altcp_keepalive_enable (struct tcp_pcb *pcb, u32_t idle, u32_t intvl, u32_t count);
+
+#define altcp_arg      tcp_arg
+#define altcp_accept   tcp_accept
+#define altcp_recv     tcp_recv
+#define altcp_sent     tcp_sent
+#define altcp_err      tcp_err
+#define altcp_poll     tcp_poll
+#define altcp_bind     tcp_bind
+#define altcp_listen   tcp_listen
+#define altcp_setprio  tcp_setprio
+#define altcp_recved   tcp_recved
+#define altcp_sndbuf   tcp_sndbuf
+#define altcp_write    tcp_write
+#define altcp_output   tcp_output
+#define altcp_close    tcp_close
+#define altcp_abort    tcp_abort
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_H
@@ -0,0 +1,12 @@
+/*
+ * Host stub of the lwIP altcp TCP allocator, used only by the tests.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_TCP_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_TCP_H
+
+#include "lwip/altcp.h"
+
+struct tcp_pcb *altcp_tcp_alloc (void *arg, u8_t ip_type);
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_TCP_H
@@ -0,0 +1,18 @@
+/*
+ * Host stub of the lwIP altcp TLS allocator, used only by the tests: the
+ * pcb keeps the configuration and the bytes are not encrypted.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_TLS_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_TLS_H
+
+#include "lwip/altcp.h"
+
+struct altcp_tls_config
+{
+    const char* name;
+};
+
+struct tcp_pcb *altcp_tls_alloc (void *arg, u8_t ip_type);
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_TLS_H
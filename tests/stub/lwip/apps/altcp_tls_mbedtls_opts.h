@@ -0,0 +1,11 @@
+/*
+ * Host stub of the lwIP mbedTLS options, used only by the tests: the
+ * fake TLS is not mbedTLS.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_TLS_MBEDTLS_OPTS_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_TLS_MBEDTLS_OPTS_H
+
+#define LWIP_ALTCP_TLS_MBEDTLS  0
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_LWIP_ALTCP_TLS_MBEDTLS_OPTS_H
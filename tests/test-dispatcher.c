@@ -0,0 +1,265 @@
+/*
+ * Tests of the command dispatcher, with the table generated by
+ * tools/ethernet-socket-phash.py (see Makefile).
+ */
+
+#include "fake-lwip.h"
+#include "ethernet-socket-dispatcher.h"
+#include "commands.h"
+
+static void say (EthernetSocketDispatcher_Reply* reply,
+                 const char* name,
+                 const uint8_t* args,
+                 uint16_t length)
+{
+    char text[128];
+    int size = snprintf(text,sizeof(text),"%s(%.*s);",name,length,(const char*)args);
+    EthernetSocketDispatcher_reply(reply,(const uint8_t*)text,size);
+}
+
+void Test_get (const uint8_t* args, uint16_t length, EthernetSocketDispatcher_Reply* reply)
+{
+    say(reply,"get",args,length);
+}
+
+void Test_set (const uint8_t* args, uint16_t length, EthernetSocketDispatcher_Reply* reply)
+{
+    say(reply,"set",args,length);
+}
+
+void Test_ping (const uint8_t* args, uint16_t length, EthernetSocketDispatcher_Reply* reply)
+{
+    say(reply,"ping",args,length);
+}
+
+void Test_status (const uint8_t* args, uint16_t length, EthernetSocketDispatcher_Reply* reply)
+{
+    say(reply,"status",args,length);
+}
+
+void Test_binary (const uint8_t* args, uint16_t length, EthernetSocketDispatcher_Reply* reply)
+{
+    say(reply,"binary",args,length);
+}
+
+static void unknown (const uint8_t* args, uint16_t length, EthernetSocketDispatcher_Reply* reply)
+{
+    say(reply,"?",args,length);
+}
+
+static uint8_t scratch[32];
+
+static const EthernetSocketDispatcher_Config lines =
+{
+    .table     = Test_table,
+    .seed      = Test_SEED,
+    .mask      = Test_MASK,
+    .framing   = ETHERNETSOCKETDISPATCHER_FRAMING_DELIMITER,
+    .delimiter = '\n',
+    .separator = ' ',
+    .maxFrame  = sizeof(scratch),
+    .scratch   = scratch,
+    .unknown   = unknown,
+};
+
+static const EthernetSocketDispatcher_Config frames =
+{
+    .table     = Test_table,
+    .seed      = Test_SEED,
+    .mask      = Test_MASK,
+    .framing   = ETHERNETSOCKETDISPATCHER_FRAMING_LENGTH,
+    .keyLength = 1,
+    .maxFrame  = sizeof(scratch),
+    .scratch   = scratch,
+};
+
+static void testTable (void)
+{
+    static const char* names[] = { "get", "set", "ping", "status", "\001" };
+    uint16_t found = 0;
+
+    // Every generated entry is where the C hash looks for it
+    for (uint16_t i = 0; i <= Test_MASK; ++i)
+    {
+        const EthernetSocketDispatcher_Command* command = &Test_table[i];
+        if (command->name == NULL)
+            continue;
+
+        found++;
+        TEST_CHECK(command->length == strlen(command->name));
+        TEST_CHECK((EthernetSocketDispatcher_hash((const uint8_t*)command->name,
+                                                  command->length,
+                                                  Test_SEED) & Test_MASK) == i);
+    }
+    TEST_CHECK(found == 5);
+
+    for (uint16_t i = 0; i < 5; ++i)
+    {
+        uint32_t index = EthernetSocketDispatcher_hash((const uint8_t*)names[i],
+                                                       strlen(names[i]),
+                                                       Test_SEED) & Test_MASK;
+        TEST_CHECK((Test_table[index].name != NULL) &&
+                   (strcmp(Test_table[index].name,names[i]) == 0));
+    }
+}
+
+static void testLines (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = Fake_connect(80);
+    int16_t available;
+
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_WEB,0,&handle);
+
+    // Lines split between segments, CR LF and unknown commands
+    Fake_send(pcb,"get temp\r\nset a 1\nbogus x\npi",28,28);
+    TEST_CHECK(EthernetSocketDispatcher_process(&lines,handle) == ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(strcmp(Fake_output(pcb),"get(temp);set(a 1);?(bogus x);") == 0);
+    Fake_take(pcb);
+    Fake_send(pcb,"ng\n",3,3);
+    EthernetSocketDispatcher_process(&lines,handle);
+    TEST_CHECK(strcmp(Fake_output(pcb),"ping();") == 0);
+    Fake_take(pcb);
+
+    // Lines that wrap around the receive ring
+    for (int i = 0; i < 40; ++i)
+    {
+        Fake_send(pcb,"status\nget abc\n",15,15);
+        EthernetSocketDispatcher_process(&lines,handle);
+        TEST_CHECK(strcmp(Fake_output(pcb),"status();get(abc);") == 0);
+        Fake_take(pcb);
+    }
+    EthernetServerSocket_handleAvailable(handle,&available);
+    TEST_CHECK(available == 0);
+    EthernetServerSocket_disconnectHandle(handle);
+}
+
+static void testTooLong (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = Fake_connect(80);
+    char line[64];
+    EthernetSocketDispatcher_Config big = lines;
+
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_WEB,0,&handle);
+
+    // The end of a too long line is not a command
+    memset(line,'x',40);
+    Fake_send(pcb,line,40,40);
+    EthernetSocketDispatcher_process(&lines,handle);
+    Fake_send(pcb,"ping hidden\nget a\n",18,18);
+    EthernetSocketDispatcher_process(&lines,handle);
+    TEST_CHECK(strcmp(Fake_output(pcb),"get(a);") == 0);
+    Fake_take(pcb);
+
+    // Also when the line wraps around the ring
+    for (int i = 0; i < 20; ++i)
+    {
+        memcpy(line,"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx ping\nset b\n",51);
+        Fake_send(pcb,line,51,51);
+        EthernetSocketDispatcher_process(&lines,handle);
+        TEST_CHECK(strcmp(Fake_output(pcb),"set(b);") == 0);
+        Fake_take(pcb);
+    }
+
+    // A frame that can't fit into the receive buffer
+    big.maxFrame = 600;
+    TEST_CHECK(EthernetSocketDispatcher_process(&big,handle) == ETHERNETSOCKET_ERROR_WRONG_CONFIG);
+    EthernetServerSocket_disconnectHandle(handle);
+}
+
+static void testLongest (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = Fake_connect(80);
+    char line[40] = "ping ";
+    char answer[48];
+
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_WEB,0,&handle);
+    memset(&line[5],'a',sizeof(scratch) - 5);
+    line[sizeof(scratch)] = '\n';
+    snprintf(answer,sizeof(answer),"ping(%.*s);",(int)sizeof(scratch) - 5,&line[5]);
+
+    // A line of maxFrame bytes, with the delimiter into the next segment
+    Fake_send(pcb,line,sizeof(scratch),sizeof(scratch));
+    EthernetSocketDispatcher_process(&lines,handle);
+    TEST_CHECK(pcb->outLength == 0);
+    Fake_send(pcb,"\n",1,1);
+    EthernetSocketDispatcher_process(&lines,handle);
+    TEST_CHECK(strcmp(Fake_output(pcb),answer) == 0);
+    Fake_take(pcb);
+
+    // Also when the line wraps around the ring
+    for (int i = 0; i < 90; ++i)
+    {
+        Fake_send(pcb,"ping\n",5,5);
+        EthernetSocketDispatcher_process(&lines,handle);
+    }
+    Fake_take(pcb);
+    Fake_send(pcb,line,sizeof(scratch) + 1,sizeof(scratch) + 1);
+    EthernetSocketDispatcher_process(&lines,handle);
+    TEST_CHECK(strcmp(Fake_output(pcb),answer) == 0);
+    Fake_take(pcb);
+
+    // One byte more is too long
+    line[sizeof(scratch)] = 'a';
+    line[sizeof(scratch) + 1] = '\n';
+    Fake_send(pcb,line,sizeof(scratch) + 2,sizeof(scratch) + 2);
+    Fake_send(pcb,"get a\n",6,6);
+    EthernetSocketDispatcher_process(&lines,handle);
+    TEST_CHECK(strcmp(Fake_output(pcb),"get(a);") == 0);
+    Fake_take(pcb);
+    EthernetServerSocket_disconnectHandle(handle);
+}
+
+static void testRemoteClose (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = Fake_connect(80);
+
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_WEB,0,&handle);
+
+    // The last complete line is answered, the incomplete one dropped
+    Fake_send(pcb,"get x\nset",9,9);
+    Fake_fin(pcb);
+    TEST_CHECK(EthernetSocketDispatcher_process(&lines,handle) == ETHERNETSOCKET_ERROR_NOT_CONNECTED);
+    TEST_CHECK(strcmp(Fake_output(pcb),"get(x);") == 0);
+    TEST_CHECK(pcb->closed);
+}
+
+static void testFrames (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = Fake_connect(80);
+
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_WEB,0,&handle);
+
+    Fake_send(pcb,"\000\003\001ab\000\001\001",8,4);
+    EthernetSocketDispatcher_process(&frames,handle);
+    TEST_CHECK(strcmp(Fake_output(pcb),"binary(ab);binary();") == 0);
+
+    // A frame longer than maxFrame closes the connection
+    Fake_send(pcb,"\001\000",2,2);
+    TEST_CHECK(EthernetSocketDispatcher_process(&frames,handle) == ETHERNETSOCKET_ERROR_NOT_CONNECTED);
+    TEST_CHECK(pcb->closed);
+}
+
+int main (void)
+{
+    EthernetSocket_Config config =
+    {
+        .currentTick = Fake_currentTick,
+    };
+
+    EthernetServerSocket_init(&config);
+    EthernetServerSocket_connect(ETHERNETSERVERSOCKET_SERVER_WEB);
+
+    testTable();
+    testLines();
+    testTooLong();
+    testLongest();
+    testRemoteClose();
+    testFrames();
+
+    return TEST_RESULT();
+}
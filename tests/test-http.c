@@ -0,0 +1,219 @@
+/*
+ * Tests of the HTTP server module.
+ */
+
+#include "fake-lwip.h"
+#include "ethernet-socket-http.h"
+
+static const char page[] = "<h1>hello</h1>";
+
+static void echo (const EthernetSocketHttp_Request* request,
+                  EthernetSocketHttp_Response* response)
+{
+    char text[128];
+    const char* agent = "";
+    uint16_t agentLength = 0;
+
+    EthernetSocketHttp_header(request,"user-agent",&agent,&agentLength);
+    int size = snprintf(text,sizeof(text),"q=%.*s a=%.*s b=%.*s",
+                        request->queryLength,request->query,
+                        agentLength,agent,
+                        request->bodyLength,(const char*)request->body);
+    EthernetSocketHttp_write(response,(const uint8_t*)text,size);
+}
+
+#define LONG_TYPE "application/vnd.a-very-long-content-type-name-that-does-not-fit-" \
+                  "into-the-response-header-buffer-of-the-module+json; charset=utf-8"
+
+static const EthernetSocketHttp_Route routes[] =
+{
+    { "GET",  "/",     "text/html",  (const uint8_t*)page, sizeof(page) - 1, NULL },
+    { "POST", "/echo", "text/plain", NULL,                 0,                echo },
+    { "GET",  "/long", LONG_TYPE,    (const uint8_t*)page, sizeof(page) - 1, NULL },
+};
+
+static uint8_t scratch[256];
+
+static const EthernetSocketHttp_Config http =
+{
+    .routes      = routes,
+    .routesCount = 3,
+    .maxRequest  = sizeof(scratch),
+    .scratch     = scratch,
+};
+
+static struct tcp_pcb* open (EthernetServerSocket_Handle* handle)
+{
+    struct tcp_pcb* pcb = Fake_connect(80);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_WEB,0,handle);
+    return pcb;
+}
+
+static void send (struct tcp_pcb* pcb, const char* text)
+{
+    Fake_send(pcb,text,strlen(text),64);
+}
+
+static void testKeepAlive (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = open(&handle);
+
+    // Pipelined requests, answered in order on the same connection
+    send(pcb,"GET / HTTP/1.1\r\nHost: a\r\n\r\n"
+             "POST /echo?k=1 HTTP/1.1\r\nUser-Agent:  test \r\nContent-Length: 3\r\n\r\nabc"
+             "GET /none HTTP/1.1\r\n\r\n");
+    TEST_CHECK(EthernetSocketHttp_process(&http,handle) == ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(strcmp(Fake_output(pcb),
+            "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 14\r\n\r\n<h1>hello</h1>"
+            "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "12\r\nq=k=1 a=test b=abc\r\n0\r\n\r\n"
+            "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 0\r\n\r\n") == 0);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == TRUE);
+    Fake_take(pcb);
+
+    // Connection: close
+    send(pcb,"GET / HTTP/1.1\r\nConnection: close\r\n\r\n");
+    EthernetSocketHttp_process(&http,handle);
+    TEST_CHECK(strstr(Fake_output(pcb),"Connection: close\r\n") != NULL);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+    TEST_CHECK(pcb->closed);
+}
+
+static void testHttp10 (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = open(&handle);
+
+    // A static body has its length: the connection can stay open
+    send(pcb,"GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+    TEST_CHECK(EthernetSocketHttp_process(&http,handle) == ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(strcmp(Fake_output(pcb),
+            "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 14\r\n\r\n<h1>hello</h1>") == 0);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == TRUE);
+    Fake_take(pcb);
+
+    // No chunked encoding: the body ends with the connection
+    send(pcb,"POST /echo HTTP/1.0\r\nConnection: keep-alive\r\nContent-Length: 1\r\n\r\nx");
+    TEST_CHECK(EthernetSocketHttp_process(&http,handle) == ETHERNETSOCKET_ERROR_NOT_CONNECTED);
+    TEST_CHECK(strcmp(Fake_output(pcb),
+            "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n"
+            "q= a= b=x") == 0);
+    TEST_CHECK(pcb->closed);
+}
+
+static void testStaticBody (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = open(&handle);
+
+    // The body waits for space into lwIP, the next request waits for it
+    pcb->sndbuf = 64;
+    send(pcb,"GET / HTTP/1.1\r\n\r\nGET /x HTTP/1.1\r\n\r\n");
+    EthernetSocketHttp_process(&http,handle);
+    TEST_CHECK(strstr(Fake_output(pcb),"<h1>") == NULL);
+    Fake_ack(pcb,100);
+    EthernetSocketHttp_process(&http,handle);
+    TEST_CHECK(strstr(Fake_output(pcb),"<h1>hello</h1>HTTP/1.1 404") != NULL);
+    EthernetServerSocket_disconnectHandle(handle);
+}
+
+static void testRemoteClose (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = open(&handle);
+
+    // Request and FIN together: answered, then closed
+    send(pcb,"GET / HTTP/1.1\r\n\r\n");
+    Fake_fin(pcb);
+    TEST_CHECK(EthernetSocketHttp_process(&http,handle) == ETHERNETSOCKET_ERROR_NOT_CONNECTED);
+    TEST_CHECK(strstr(Fake_output(pcb),"<h1>hello</h1>") != NULL);
+    TEST_CHECK(pcb->closed);
+
+    // Incomplete request and FIN: it will never be complete
+    pcb = open(&handle);
+    send(pcb,"GET / HTTP/1.1\r\n");
+    Fake_fin(pcb);
+    TEST_CHECK(EthernetSocketHttp_process(&http,handle) == ETHERNETSOCKET_ERROR_NOT_CONNECTED);
+    TEST_CHECK(pcb->outLength == 0);
+    TEST_CHECK(pcb->closed);
+}
+
+static void testErrors (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = open(&handle);
+
+    send(pcb,"GARBAGE\r\n\r\n");
+    EthernetSocketHttp_process(&http,handle);
+    TEST_CHECK(strncmp(Fake_output(pcb),"HTTP/1.1 400",12) == 0);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+
+    // A header too long for the module: nothing sent, connection closed
+    pcb = open(&handle);
+    send(pcb,"GET /long HTTP/1.1\r\n\r\n");
+    EthernetSocketHttp_process(&http,handle);
+    TEST_CHECK(pcb->outLength == 0);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+
+    pcb = open(&handle);
+    send(pcb,"POST /echo HTTP/1.1\r\nContent-Length: 1000\r\n\r\n");
+    EthernetSocketHttp_process(&http,handle);
+    TEST_CHECK(strncmp(Fake_output(pcb),"HTTP/1.1 413",12) == 0);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+
+    // Empty or not a number
+    static const char* lengths[] = { "", "3x", "-1", "+3", "1 2", "0x10" };
+    for (int i = 0; i < 6; ++i)
+    {
+        char request[96];
+        snprintf(request,sizeof(request),
+                 "POST /echo HTTP/1.1\r\nContent-Length: %s\r\n\r\nabc",lengths[i]);
+        pcb = open(&handle);
+        send(pcb,request);
+        EthernetSocketHttp_process(&http,handle);
+        TEST_CHECK(strncmp(Fake_output(pcb),"HTTP/1.1 400",12) == 0);
+        TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+    }
+
+    // Too long before the value wraps around 32 bits
+    pcb = open(&handle);
+    send(pcb,"POST /echo HTTP/1.1\r\nContent-Length: 4294967297\r\n\r\nabc");
+    EthernetSocketHttp_process(&http,handle);
+    TEST_CHECK(strncmp(Fake_output(pcb),"HTTP/1.1 413",12) == 0);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+
+    // Headers longer than maxRequest, without the empty line
+    pcb = open(&handle);
+    for (int i = 0; i < 10; ++i)
+        send(pcb,"X-Filler: 0123456789012345678901234567890123456789\r\n");
+    EthernetSocketHttp_process(&http,handle);
+    TEST_CHECK(strncmp(Fake_output(pcb),"HTTP/1.1 413",12) == 0);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+
+    // A request that can't fit into the receive buffer
+    EthernetSocketHttp_Config big = http;
+    big.maxRequest = 1024;
+    pcb = open(&handle);
+    TEST_CHECK(EthernetSocketHttp_process(&big,handle) == ETHERNETSOCKET_ERROR_WRONG_CONFIG);
+    EthernetServerSocket_disconnectHandle(handle);
+}
+
+int main (void)
+{
+    EthernetSocket_Config config =
+    {
+        .currentTick = Fake_currentTick,
+    };
+
+    EthernetServerSocket_init(&config);
+    EthernetServerSocket_connect(ETHERNETSERVERSOCKET_SERVER_WEB);
+
+    testKeepAlive();
+    testHttp10();
+    testStaticBody();
+    testRemoteClose();
+    testErrors();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,494 @@
+/*
+ * Tests of the server socket: transport calls, handles and generations,
+ * receive ring and transmit ring, over the fake lwIP.
+ */
+
+#include "fake-lwip.h"
+#include "ethernet-serversocket.h"
+
+static uint32_t txWaterHandle;
+static int txWaterHigh = -1;
+
+static void txWater (uint32_t handle, uint8_t high)
+{
+    txWaterHandle = handle;
+    txWaterHigh = high;
+}
+
+static uint8_t refill[200];
+static EthernetServerSocket_Handle refillHandle;
+
+/* Write more as soon as the buffer is low, from inside the scheduler */
+static void txRefill (uint32_t handle, uint8_t high)
+{
+    uint16_t wrote;
+
+    if ((high == FALSE) && (refillHandle == handle))
+    {
+        refillHandle = ETHERNETSERVERSOCKET_HANDLE_INVALID;
+        TEST_CHECK(EthernetServerSocket_handleWriteBytes(handle,&refill[100],40,&wrote) ==
+                ETHERNETSOCKET_ERROR_OK);
+    }
+}
+
+static int wakes;
+
+static void wake (void)
+{
+    wakes++;
+}
+
+static void testTransport (void)
+{
+    struct tcp_pcb* pcb;
+
+    TEST_CHECK(Fake_listener(23) != NULL);
+    TEST_CHECK(Fake_listener(5000) != NULL);
+    TEST_CHECK(Fake_listener(80) != NULL);
+    TEST_CHECK(EthernetServerSocket_connect(ETHERNETSERVERSOCKET_SERVERS) ==
+            ETHERNETSOCKET_ERROR_WRONG_SOCKET_NUMBER);
+
+    // Keepalive from the table, with the default interval and count
+    pcb = Fake_connect(23);
+    TEST_CHECK(pcb != NULL);
+    TEST_CHECK((pcb->so_options & SOF_KEEPALIVE) != 0);
+    TEST_CHECK(pcb->keep_idle == 5000);
+    TEST_CHECK(pcb->keep_intvl == ETHERNET_SOCKET_KEEPALIVE_INTERVAL);
+    TEST_CHECK(pcb->keep_cnt == ETHERNET_SOCKET_KEEPALIVE_COUNT);
+    TEST_CHECK(pcb->recv != NULL);
+    TEST_CHECK(pcb->err != NULL);
+    EthernetServerSocket_disconnectClient(ETHERNETSERVERSOCKET_SERVER_ECHO,0);
+    TEST_CHECK(pcb->closed);
+
+    // No keepalive for the others
+    pcb = Fake_connect(80);
+    TEST_CHECK((pcb->so_options & SOF_KEEPALIVE) == 0);
+    EthernetServerSocket_disconnectClient(ETHERNETSERVERSOCKET_SERVER_WEB,0);
+}
+
+#if LWIP_ALTCP_TLS
+static void testTls (void)
+{
+    struct altcp_tls_config tls = { "test" };
+    struct tcp_pcb* pcb;
+
+    // The transport can't change while the server is open
+    TEST_CHECK(EthernetServerSocket_setTls(ETHERNETSERVERSOCKET_SERVER_WEB,&tls) ==
+            ETHERNETSOCKET_ERROR_JUST_CONNECTED);
+    TEST_CHECK(EthernetServerSocket_disconnect(ETHERNETSERVERSOCKET_SERVER_WEB) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(EthernetServerSocket_setTls(ETHERNETSERVERSOCKET_SERVER_WEB,&tls) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(EthernetServerSocket_connect(ETHERNETSERVERSOCKET_SERVER_WEB) ==
+            ETHERNETSOCKET_ERROR_OK);
+    pcb = Fake_connect(80);
+    TEST_CHECK((pcb != NULL) && (pcb->tls == &tls));
+    EthernetServerSocket_disconnectClient(ETHERNETSERVERSOCKET_SERVER_WEB,0);
+
+    // Back to plain TCP
+    EthernetServerSocket_disconnect(ETHERNETSERVERSOCKET_SERVER_WEB);
+    TEST_CHECK(EthernetServerSocket_setTls(ETHERNETSERVERSOCKET_SERVER_WEB,NULL) ==
+            ETHERNETSOCKET_ERROR_OK);
+    EthernetServerSocket_connect(ETHERNETSERVERSOCKET_SERVER_WEB);
+    pcb = Fake_connect(80);
+    TEST_CHECK((pcb != NULL) && (pcb->tls == NULL));
+    EthernetServerSocket_disconnectClient(ETHERNETSERVERSOCKET_SERVER_WEB,0);
+}
+#endif
+
+static void testHandles (void)
+{
+    EthernetServerSocket_Handle first, second, other;
+    struct tcp_pcb* pcb[3];
+    uint8_t clients;
+
+    TEST_CHECK(EthernetServerSocket_isValid(ETHERNETSERVERSOCKET_HANDLE_INVALID) == FALSE);
+
+    pcb[0] = Fake_connect(23);
+    pcb[1] = Fake_connect(23);
+    pcb[2] = Fake_connect(23);
+    TEST_CHECK((pcb[0] != NULL) && (pcb[1] != NULL));
+    TEST_CHECK(pcb[2] == NULL);
+    TEST_CHECK(EthernetServerSocket_clients(ETHERNETSERVERSOCKET_SERVER_ECHO,&clients) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(clients == 2);
+
+    TEST_CHECK(EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&first) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,1,&other) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(first != ETHERNETSERVERSOCKET_HANDLE_INVALID);
+    TEST_CHECK(first != other);
+    TEST_CHECK(EthernetServerSocket_isValid(first) == TRUE);
+
+    // A closed connection makes its handle stale, also after the slot reuse
+    TEST_CHECK(EthernetServerSocket_disconnectHandle(first) == ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(pcb[0]->closed);
+    TEST_CHECK(EthernetServerSocket_isValid(first) == FALSE);
+    TEST_CHECK(EthernetServerSocket_disconnectHandle(first) == ETHERNETSOCKET_ERROR_NOT_CONNECTED);
+    TEST_CHECK(EthernetServerSocket_handleWrite(first,'x') == ETHERNETSOCKET_ERROR_NOT_CONNECTED);
+
+    pcb[0] = Fake_connect(23);
+    TEST_CHECK(pcb[0] != NULL);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&second);
+    TEST_CHECK(second != first);
+    TEST_CHECK(EthernetServerSocket_isValid(first) == FALSE);
+    TEST_CHECK(EthernetServerSocket_isValid(second) == TRUE);
+
+    // lwIP frees the pcb on errors: the slot is free at once
+    Fake_error(pcb[1],ERR_RST);
+    TEST_CHECK(EthernetServerSocket_isValid(other) == FALSE);
+    EthernetServerSocket_clients(ETHERNETSERVERSOCKET_SERVER_ECHO,&clients);
+    TEST_CHECK(clients == 1);
+
+    EthernetServerSocket_disconnectHandle(second);
+    EthernetServerSocket_clients(ETHERNETSERVERSOCKET_SERVER_ECHO,&clients);
+    TEST_CHECK(clients == 0);
+}
+
+static void testReceiveRing (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = Fake_connect(23);
+    uint8_t buffer[64];
+    const uint8_t* span;
+    uint16_t length;
+    int16_t available;
+    uint8_t data;
+
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&handle);
+
+    // A chained segment is stored whole
+    TEST_CHECK(Fake_send(pcb,"hello world",11,3) == ERR_OK);
+    TEST_CHECK(EthernetServerSocket_available(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&available) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(available == 11);
+    TEST_CHECK(EthernetServerSocket_peek(handle,6,buffer,5,&length) == ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK((length == 5) && (memcmp(buffer,"world",5) == 0));
+    TEST_CHECK(EthernetServerSocket_read(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&data) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(data == 'h');
+    TEST_CHECK(EthernetServerSocket_readBytes(ETHERNETSERVERSOCKET_SERVER_ECHO,0,buffer,10,&length) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK((length == 10) && (memcmp(buffer,"ello world",10) == 0));
+    TEST_CHECK(EthernetServerSocket_handleRead(handle,&data) == ETHERNETSOCKET_ERROR_BUFFER_NO_DATA);
+
+    // Wrap around the end of the 64 bytes ring: two spans
+    TEST_CHECK(Fake_send(pcb,"0123456789012345678901234567890123456789012345678",49,49) == ERR_OK);
+    TEST_CHECK(EthernetServerSocket_getReadSpan(handle,&span,&length) == ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(length == 49);
+    TEST_CHECK(EthernetServerSocket_commitRead(handle,49) == ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(Fake_send(pcb,"abcdefghij",10,10) == ERR_OK);
+    EthernetServerSocket_getReadSpan(handle,&span,&length);
+    TEST_CHECK((length == 4) && (memcmp(span,"abcd",4) == 0));
+    TEST_CHECK(EthernetServerSocket_peek(handle,0,buffer,10,&length) == ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK((length == 10) && (memcmp(buffer,"abcdefghij",10) == 0));
+    EthernetServerSocket_commitRead(handle,4);
+    EthernetServerSocket_getReadSpan(handle,&span,&length);
+    TEST_CHECK((length == 6) && (memcmp(span,"efghij",6) == 0));
+    TEST_CHECK(EthernetServerSocket_commitRead(handle,7) != ETHERNETSOCKET_ERROR_OK);
+    EthernetServerSocket_commitRead(handle,6);
+    EthernetServerSocket_handleAvailable(handle,&available);
+    TEST_CHECK(available == 0);
+
+    // A new connection doesn't see the data of the previous one
+    Fake_send(pcb,"old",3,3);
+    EthernetServerSocket_disconnectHandle(handle);
+    pcb = Fake_connect(23);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&handle);
+    EthernetServerSocket_handleAvailable(handle,&available);
+    TEST_CHECK(available == 0);
+    EthernetServerSocket_disconnectHandle(handle);
+}
+
+static void testBackpressure (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb = Fake_connect(23);
+    char data[200];
+    uint8_t buffer[200];
+    uint16_t length;
+    uint16_t total;
+
+    for (int i = 0; i < 200; ++i)
+        data[i] = 'a' + (i % 26);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&handle);
+
+    // The bytes are acknowledged when read, not when stored
+    TEST_CHECK(Fake_send(pcb,data,20,20) == ERR_OK);
+    TEST_CHECK(pcb->recved == 0);
+
+    // Fits the buffer but not its free space: the rest waits, nothing lost
+    TEST_CHECK(Fake_send(pcb,&data[20],58,16) == ERR_OK);
+    TEST_CHECK(EthernetServerSocket_handleCapacity(handle) == 63);
+    EthernetServerSocket_handleRead(handle,buffer);
+    TEST_CHECK(pcb->recved == 1);
+    EthernetServerSocket_peek(handle,0,&buffer[1],39,&length);
+    EthernetServerSocket_commitRead(handle,length);
+    TEST_CHECK(pcb->recved == 40);
+    EthernetServerSocket_readBytes(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&buffer[40],sizeof(buffer),&length);
+    TEST_CHECK((length == 38) && (memcmp(buffer,data,78) == 0));
+    TEST_CHECK(pcb->recved == 78);
+    TEST_CHECK(Fake_pbufs == 0);
+
+    // Longer than the whole buffer, behind a segment still waiting
+    TEST_CHECK(Fake_send(pcb,data,100,32) == ERR_OK);
+    TEST_CHECK(Fake_send(pcb,&data[100],100,60) == ERR_OK);
+    for (total = 0; total < 200; total += length)
+    {
+        EthernetServerSocket_readBytes(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&buffer[total],25,&length);
+        if (length == 0)
+            break;
+    }
+    TEST_CHECK((total == 200) && (memcmp(buffer,data,200) == 0));
+    TEST_CHECK(pcb->recved == 278);
+    TEST_CHECK(Fake_pbufs == 0);
+
+    // The bytes still waiting are freed with the client
+    TEST_CHECK(Fake_send(pcb,data,100,50) == ERR_OK);
+    TEST_CHECK(Fake_pbufs != 0);
+    EthernetServerSocket_disconnectHandle(handle);
+    TEST_CHECK(Fake_pbufs == 0);
+}
+
+static void testRemoteClose (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb;
+    uint8_t buffer[16];
+    uint16_t length;
+    int16_t available;
+
+    // Nothing to read: closed at once
+    pcb = Fake_connect(23);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&handle);
+    TEST_CHECK(Fake_fin(pcb) == ERR_OK);
+    TEST_CHECK(pcb->closed);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+
+    // A request followed by FIN is still readable and can be answered
+    pcb = Fake_connect(23);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&handle);
+    Fake_send(pcb,"get x\n",6,6);
+    TEST_CHECK(Fake_fin(pcb) == ERR_OK);
+    TEST_CHECK(!pcb->closed);
+    TEST_CHECK(EthernetServerSocket_handleRemoteClosed(handle) == TRUE);
+    TEST_CHECK(EthernetServerSocket_available(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&available) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(available == 6);
+    EthernetServerSocket_readBytes(ETHERNETSERVERSOCKET_SERVER_ECHO,0,buffer,sizeof(buffer),&length);
+    TEST_CHECK((length == 6) && (memcmp(buffer,"get x\n",6) == 0));
+    TEST_CHECK(EthernetServerSocket_writeBytes(ETHERNETSERVERSOCKET_SERVER_ECHO,0,(uint8_t*)"x=1\n",4,&length) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(strcmp(Fake_output(pcb),"x=1\n") == 0);
+
+    // All read: the next check closes the connection
+    TEST_CHECK(EthernetServerSocket_available(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&available) ==
+            ETHERNETSOCKET_ERROR_NOT_CONNECTED);
+    TEST_CHECK(pcb->closed);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+}
+
+static void testTransmit (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb;
+    uint8_t buffer[200];
+    uint16_t wrote;
+
+    // Without transmit ring the write is clamped to the lwIP space
+    pcb = Fake_connect(80);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_WEB,0,&handle);
+    pcb->sndbuf = 5;
+    TEST_CHECK(EthernetServerSocket_handleWriteBytes(handle,(uint8_t*)"0123456789",10,&wrote) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(wrote == 5);
+    TEST_CHECK(strcmp(Fake_output(pcb),"01234") == 0);
+    TEST_CHECK(pcb->outputs == 1);
+    EthernetServerSocket_disconnectHandle(handle);
+
+    // With transmit ring the writes are all or nothing
+    for (int i = 0; i < 200; ++i)
+        buffer[i] = 'a' + (i % 26);
+    Fake_txWater = txWater;
+    pcb = Fake_connect(5000);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_QUEUE,0,&handle);
+    pcb->sndbuf = 10;
+    TEST_CHECK(EthernetServerSocket_handleWriteBytes(handle,buffer,100,&wrote) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(wrote == 100);
+    TEST_CHECK(pcb->outLength == 10);
+    TEST_CHECK((txWaterHigh == TRUE) && (txWaterHandle == handle));
+    TEST_CHECK(EthernetServerSocket_handleWriteBytes(handle,&buffer[100],50,&wrote) ==
+            ETHERNETSOCKET_ERROR_BUFFER_FULL);
+    TEST_CHECK(wrote == 0);
+    TEST_CHECK(EthernetServerSocket_handleWriteBytes(handle,&buffer[100],20,&wrote) ==
+            ETHERNETSOCKET_ERROR_OK);
+
+    // The ring drains when lwIP has space again
+    for (int i = 0; (i < 20) && (pcb->outLength < 120); ++i)
+        Fake_ack(pcb,40);
+    TEST_CHECK(pcb->outLength == 120);
+    TEST_CHECK(memcmp(Fake_output(pcb),buffer,120) == 0);
+    TEST_CHECK(txWaterHigh == FALSE);
+    EthernetServerSocket_disconnectHandle(handle);
+    Fake_txWater = NULL;
+}
+
+static void testTransmitRefill (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb;
+    uint16_t wrote;
+
+    for (int i = 0; i < 200; ++i)
+        refill[i] = 'A' + (i % 26);
+    Fake_txWater = txRefill;
+
+    // The bytes written by the callback follow, the deficit stays sane
+    for (u16_t space = 16; space <= 140; space += 4)
+    {
+        pcb = Fake_connect(5000);
+        EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_QUEUE,0,&handle);
+        refillHandle = handle;
+        pcb->sndbuf = 0;
+        EthernetServerSocket_handleWriteBytes(handle,refill,100,&wrote);
+
+        pcb->sndbuf = space;
+        TEST_CHECK(Fake_poll(pcb) == ERR_OK);
+        TEST_CHECK(EthernetServerSocket_clientData[handle & 0xFF].deficit < 32);
+        for (int i = 0; (i < 20) && (pcb->outLength < 140); ++i)
+            Fake_ack(pcb,20);
+        TEST_CHECK(refillHandle == ETHERNETSERVERSOCKET_HANDLE_INVALID);
+        TEST_CHECK((pcb->outLength == 140) && (memcmp(pcb->out,refill,140) == 0));
+        EthernetServerSocket_disconnectHandle(handle);
+        TEST_CHECK(pcb->closed);
+    }
+    Fake_txWater = NULL;
+}
+
+static void testGracefulClose (void)
+{
+    EthernetServerSocket_Handle handle, next;
+    struct tcp_pcb* pcb;
+    uint8_t buffer[100];
+    uint16_t wrote;
+    uint8_t clients;
+
+    for (int i = 0; i < 100; ++i)
+        buffer[i] = '0' + (i % 10);
+
+    // The transmit buffer is sent before the close
+    pcb = Fake_connect(5000);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_QUEUE,0,&handle);
+    pcb->sndbuf = 30;
+    EthernetServerSocket_handleWriteBytes(handle,buffer,100,&wrote);
+    TEST_CHECK(pcb->outLength == 30);
+    TEST_CHECK(Fake_send(pcb,buffer,100,100) == ERR_OK);
+    TEST_CHECK(Fake_send(pcb,buffer,100,100) == ERR_OK);
+    TEST_CHECK(Fake_send(pcb,buffer,100,100) == ERR_OK);
+    TEST_CHECK(EthernetServerSocket_disconnectHandle(handle) == ETHERNETSOCKET_ERROR_OK);
+    // The bytes not read are acknowledged, also the ones waiting
+    TEST_CHECK(pcb->recved == 300);
+    TEST_CHECK(Fake_pbufs == 0);
+    pcb->recved = 0;
+    TEST_CHECK(!pcb->closed);
+    TEST_CHECK(EthernetServerSocket_isValid(handle) == FALSE);
+    TEST_CHECK(EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_QUEUE,0,&next) ==
+            ETHERNETSOCKET_ERROR_NOT_CONNECTED);
+    EthernetServerSocket_clients(ETHERNETSERVERSOCKET_SERVER_QUEUE,&clients);
+    TEST_CHECK(clients == 1);
+
+    // The data of the closing client are dropped
+    TEST_CHECK(Fake_send(pcb,"late",4,4) == ERR_OK);
+    TEST_CHECK(pcb->recved == 4);
+
+    TEST_CHECK(Fake_ack(pcb,30) == ERR_OK);
+    TEST_CHECK(!pcb->closed);
+    TEST_CHECK(Fake_ack(pcb,40) == ERR_OK);
+    TEST_CHECK(pcb->closed);
+    TEST_CHECK((pcb->outLength == 100) && (memcmp(pcb->out,buffer,100) == 0));
+    EthernetServerSocket_clients(ETHERNETSERVERSOCKET_SERVER_QUEUE,&clients);
+    TEST_CHECK(clients == 0);
+
+    // Without data waiting for an ack, the poll sends the buffer
+    pcb = Fake_connect(5000);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_QUEUE,0,&handle);
+    TEST_CHECK(pcb->poll != NULL);
+    pcb->sndbuf = 0;
+    EthernetServerSocket_handleWriteBytes(handle,buffer,50,&wrote);
+    TEST_CHECK(wrote == 50);
+    TEST_CHECK(pcb->outLength == 0);
+    EthernetServerSocket_disconnectClient(ETHERNETSERVERSOCKET_SERVER_QUEUE,0);
+    TEST_CHECK(!pcb->closed);
+    pcb->sndbuf = FAKE_SNDBUF;
+    TEST_CHECK(Fake_poll(pcb) == ERR_OK);
+    TEST_CHECK(pcb->closed);
+    TEST_CHECK((pcb->outLength == 50) && (memcmp(pcb->out,buffer,50) == 0));
+
+    // A reset frees the closing client at once
+    pcb = Fake_connect(5000);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_QUEUE,0,&handle);
+    pcb->sndbuf = 0;
+    EthernetServerSocket_handleWriteBytes(handle,buffer,50,&wrote);
+    EthernetServerSocket_disconnectHandle(handle);
+    Fake_error(pcb,ERR_RST);
+    EthernetServerSocket_clients(ETHERNETSERVERSOCKET_SERVER_QUEUE,&clients);
+    TEST_CHECK(clients == 0);
+}
+
+static void testWait (void)
+{
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb;
+    uint16_t wrote;
+
+    // Every event wakes, until it's taken by wait
+    wakes = 0;
+    pcb = Fake_connect(80);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_WEB,0,&handle);
+    TEST_CHECK(wakes == 1);
+    TEST_CHECK(EthernetServerSocket_wait(0) == TRUE);
+    TEST_CHECK(EthernetServerSocket_wait(0) == FALSE);
+
+    // Also without transmit buffer, space into lwIP is an event
+    TEST_CHECK(pcb->sent != NULL);
+    EthernetServerSocket_handleWriteBytes(handle,(uint8_t*)"abc",3,&wrote);
+    TEST_CHECK(EthernetServerSocket_wait(0) == FALSE);
+    TEST_CHECK(Fake_ack(pcb,3) == ERR_OK);
+    TEST_CHECK(wakes == 2);
+    TEST_CHECK(EthernetServerSocket_wait(0) == TRUE);
+
+    Fake_send(pcb,"x",1,1);
+    TEST_CHECK(wakes == 3);
+    EthernetServerSocket_disconnectHandle(handle);
+    EthernetServerSocket_wait(0);
+}
+
+int main (void)
+{
+    EthernetSocket_Config config =
+    {
+        .currentTick = Fake_currentTick,
+        .wake        = wake,
+    };
+
+    EthernetServerSocket_init(&config);
+    for (uint8_t i = 0; i < ETHERNETSERVERSOCKET_SERVERS; ++i)
+        TEST_CHECK(EthernetServerSocket_connect(i) == ETHERNETSOCKET_ERROR_OK);
+
+    testTransport();
+#if LWIP_ALTCP_TLS
+    testTls();
+#endif
+    testHandles();
+    testReceiveRing();
+    testBackpressure();
+    testRemoteClose();
+    testTransmit();
+    testTransmitRefill();
+    testGracefulClose();
+    testWait();
+
+    return TEST_RESULT();
+}
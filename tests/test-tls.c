@@ -0,0 +1,225 @@
+/*
+ * Test of the TLS transport over the real lwIP and mbedTLS (see the tls
+ * target of the Makefile): a client connects to the echo server through
+ * the loopback interface, and resumes its session at the next connection.
+ *
+ * Usage: test-tls cert.pem key.pem
+ */
+
+#include "test.h"
+#include "ethernet-serversocket.h"
+
+#include "lwip/altcp_tls.h"
+#include "lwip/netif.h"
+#include "mbedtls/ssl.h"
+
+#include <stdlib.h>
+
+/* The session fields are private from mbedTLS 3 */
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+int Test_failures = 0;
+
+typedef struct _Test_Client
+{
+    char received[16];
+    uint16_t length;
+    bool connected;
+    bool closed;
+} Test_Client;
+
+/* Run lwIP and the server until the condition is true, at most 5 s */
+#define TEST_RUN(condition)                                                \
+    for (uint32_t start = sys_now();                                       \
+         !(condition) && ((sys_now() - start) < 5000); )                   \
+        step()
+
+static uint8_t* load (const char* name, size_t* length)
+{
+    FILE* file = fopen(name,"rb");
+    uint8_t* data;
+    long size;
+
+    if (file == NULL)
+        return NULL;
+
+    fseek(file,0,SEEK_END);
+    size = ftell(file);
+    rewind(file);
+
+    // mbedTLS wants the terminator of a PEM text into its length
+    data = malloc(size + 1);
+    *length = fread(data,1,size,file) + 1;
+    data[*length - 1] = 0;
+    fclose(file);
+    return data;
+}
+
+static uint32_t currentTick (void)
+{
+    return sys_now();
+}
+
+/* The echo server, over the library */
+static void serve (void)
+{
+    EthernetServerSocket_Handle handle;
+    uint8_t buffer[64];
+    uint16_t length;
+    uint16_t wrote;
+
+    for (uint8_t i = 0; i < ETHERNETSERVERSOCKET_CLIENTS_ECHO; ++i)
+    {
+        if (EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,i,&handle) !=
+                ETHERNETSOCKET_ERROR_OK)
+            continue;
+
+        EthernetServerSocket_peek(handle,0,buffer,sizeof(buffer),&length);
+        if (length == 0)
+            continue;
+        if (EthernetServerSocket_handleWriteBytes(handle,buffer,length,&wrote) ==
+                ETHERNETSOCKET_ERROR_OK)
+            EthernetServerSocket_commitRead(handle,wrote);
+    }
+}
+
+static void step (void)
+{
+    netif_poll_all();
+    sys_check_timeouts();
+    serve();
+}
+
+static err_t clientReceive (void* arg, struct altcp_pcb* pcb, struct pbuf* p, err_t err)
+{
+    Test_Client* client = (Test_Client*)arg;
+
+    if (p == NULL)
+    {
+        client->closed = TRUE;
+        return ERR_OK;
+    }
+
+    client->length += pbuf_copy_partial(p,&client->received[client->length],
+                                        sizeof(client->received) - 1 - client->length,0);
+    altcp_recved(pcb,p->tot_len);
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+static void clientError (void* arg, err_t err)
+{
+    ((Test_Client*)arg)->closed = TRUE;
+}
+
+/* Called after the handshake */
+static err_t clientConnected (void* arg, struct altcp_pcb* pcb, err_t err)
+{
+    ((Test_Client*)arg)->connected = TRUE;
+    altcp_write(pcb,"ping",4,TCP_WRITE_FLAG_COPY);
+    altcp_output(pcb);
+    return ERR_OK;
+}
+
+static struct altcp_pcb* connectClient (struct altcp_tls_config* config,
+                                        struct altcp_tls_session* session,
+                                        Test_Client* client)
+{
+    ip_addr_t address = IPADDR4_INIT_BYTES(127,0,0,1);
+    struct altcp_pcb* pcb = altcp_tls_new(config,IPADDR_TYPE_V4);
+
+    memset(client,0,sizeof(Test_Client));
+    altcp_arg(pcb,client);
+    altcp_recv(pcb,clientReceive);
+    altcp_err(pcb,clientError);
+    if (session != NULL)
+        TEST_CHECK(altcp_tls_set_session(pcb,session) == ERR_OK);
+    TEST_CHECK(altcp_connect(pcb,&address,4433,clientConnected) == ERR_OK);
+
+    TEST_RUN((client->length == 4) || client->closed);
+    TEST_CHECK(client->connected);
+    TEST_CHECK((client->length == 4) && (memcmp(client->received,"ping",4) == 0));
+    return pcb;
+}
+
+static uint8_t serverClients (void)
+{
+    uint8_t clients = 0;
+
+    EthernetServerSocket_clients(ETHERNETSERVERSOCKET_SERVER_ECHO,&clients);
+    return clients;
+}
+
+static void closeClient (struct altcp_pcb* pcb)
+{
+    altcp_close(pcb);
+    TEST_RUN(serverClients() == 0);
+    TEST_CHECK(serverClients() == 0);
+}
+
+static size_t sessionId (struct altcp_pcb* pcb, uint8_t id[32])
+{
+    const mbedtls_ssl_session* session =
+            mbedtls_ssl_get_session_pointer((mbedtls_ssl_context*)altcp_tls_context(pcb));
+
+    memcpy(id,session->MBEDTLS_PRIVATE(id),session->MBEDTLS_PRIVATE(id_len));
+    return session->MBEDTLS_PRIVATE(id_len);
+}
+
+int main (int argc, char* argv[])
+{
+    EthernetSocket_Config config =
+    {
+        .currentTick = currentTick,
+    };
+    size_t certLength;
+    size_t keyLength;
+    uint8_t* cert = (argc == 3) ? load(argv[1],&certLength) : NULL;
+    uint8_t* key = (argc == 3) ? load(argv[2],&keyLength) : NULL;
+    uint8_t first[32];
+    uint8_t second[32];
+    size_t firstLength;
+    size_t secondLength;
+    Test_Client client;
+
+    if ((cert == NULL) || (key == NULL))
+    {
+        printf("usage: %s cert.pem key.pem\n",argv[0]);
+        return 1;
+    }
+
+    lwip_init();
+
+    struct altcp_tls_config* server =
+            altcp_tls_create_config_server_privkey_cert(key,keyLength,NULL,0,cert,certLength);
+    struct altcp_tls_config* tls = altcp_tls_create_config_client(cert,certLength);
+    TEST_CHECK((server != NULL) && (tls != NULL));
+
+    EthernetServerSocket_init(&config);
+    TEST_CHECK(EthernetServerSocket_setTls(ETHERNETSERVERSOCKET_SERVER_ECHO,server) ==
+            ETHERNETSOCKET_ERROR_OK);
+    TEST_CHECK(EthernetServerSocket_connect(ETHERNETSERVERSOCKET_SERVER_ECHO) ==
+            ETHERNETSOCKET_ERROR_OK);
+
+    // Full handshake, the client keeps the session
+    struct altcp_tls_session* session = altcp_tls_alloc_session();
+    struct altcp_pcb* pcb = connectClient(tls,NULL,&client);
+    TEST_CHECK(altcp_tls_get_session(pcb,session) == ERR_OK);
+    firstLength = sessionId(pcb,first);
+    TEST_CHECK(firstLength > 0);
+    closeClient(pcb);
+
+    // The server finds the session into its cache: same session ID
+    pcb = connectClient(tls,session,&client);
+    secondLength = sessionId(pcb,second);
+    TEST_CHECK((secondLength == firstLength) && (memcmp(first,second,firstLength) == 0));
+    closeClient(pcb);
+
+    altcp_tls_free_session(session);
+    altcp_tls_free_config(tls);
+    free(cert);
+    free(key);
+    return TEST_RESULT();
+}
@@ -0,0 +1,53 @@
+/*
+ * Tests of the trace ring, the dump is decoded by
+ * tools/ethernet-socket-trace.py (see Makefile).
+ */
+
+#include "fake-lwip.h"
+#include "ethernet-serversocket.h"
+
+static FILE* dump;
+static uint32_t dumped;
+
+static void write (const uint8_t* data, uint16_t length)
+{
+    fwrite(data,1,length,dump);
+    dumped += length;
+}
+
+int main (int argc, char* argv[])
+{
+    EthernetSocket_Config config =
+    {
+        .currentTick = Fake_currentTick,
+    };
+    EthernetServerSocket_Handle handle;
+    struct tcp_pcb* pcb;
+    uint8_t buffer[16];
+    uint16_t length;
+
+    EthernetServerSocket_init(&config);
+    EthernetServerSocket_connect(ETHERNETSERVERSOCKET_SERVER_ECHO);
+
+    Fake_tick = 100;
+    pcb = Fake_connect(23);
+    EthernetServerSocket_getHandle(ETHERNETSERVERSOCKET_SERVER_ECHO,0,&handle);
+    Fake_tick = 110;
+    Fake_send(pcb,"ping",4,4);
+    Fake_tick = 115;
+    EthernetServerSocket_readBytes(ETHERNETSERVERSOCKET_SERVER_ECHO,0,buffer,sizeof(buffer),&length);
+    Fake_tick = 120;
+    EthernetServerSocket_handleWriteBytes(handle,(uint8_t*)"pong",4,&length);
+    Fake_tick = 130;
+    EthernetServerSocket_disconnectHandle(handle);
+
+    dump = fopen((argc > 1) ? argv[1] : "trace.bin","wb");
+    TEST_CHECK(dump != NULL);
+    EthernetSocket_traceDump(write);
+    fclose(dump);
+
+    // ACCEPT RECEIVE READ WRITE OUTPUT CLOSE
+    TEST_CHECK(dumped == ETHERNETSOCKET_TRACE_HEADER_SIZE + 6 * ETHERNETSOCKET_TRACE_RECORD_SIZE);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,25 @@
+/*
+ * Checks of the tests: a failed check is printed and counted, and the
+ * test returns the result.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_H
+
+#include <stdio.h>
+
+extern int Test_failures;
+
+#define TEST_CHECK(condition)                                              \
+    do {                                                                   \
+        if (!(condition))                                                  \
+        {                                                                  \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            Test_failures++;                                               \
+        }                                                                  \
+    } while (0)
+
+#define TEST_RESULT() \
+    (printf("%s: %s\n", __FILE__, (Test_failures == 0) ? "ok" : "FAILED"), Test_failures != 0)
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_H
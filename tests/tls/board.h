@@ -0,0 +1,14 @@
+/*
+ * Board configuration of the TLS test.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_BOARD_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_BOARD_H
+
+#define ETHERNET_MAX_SOCKET_CLIENT 2
+
+#define ETHERNET_SERVER_TABLE(SERVER)                                      \
+    SERVER(ECHO,  2, 512, 0,   .port = 4433,                               \
+                               .keepIdle = 5000)
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_BOARD_H
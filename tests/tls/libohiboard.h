@@ -0,0 +1,21 @@
+/*
+ * Host stub of libohiboard for the TLS test: the library runs over the
+ * real lwIP, see tls/lwipopts.h.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_LIBOHIBOARD_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_LIBOHIBOARD_H
+
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t bool;
+#define TRUE  1
+#define FALSE 0
+
+#include "lwip/init.h"
+#include "lwip/tcp.h"
+#include "lwip/pbuf.h"
+#include "lwip/timeouts.h"
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_LIBOHIBOARD_H
@@ -0,0 +1,41 @@
+/*
+ * lwIP options of the TLS test: the real stack without an operating
+ * system, over its loopback interface, with altcp and mbedTLS.
+ */
+
+#ifndef __OHILAB_ETHERNET_SOCKET_TEST_LWIPOPTS_H
+#define __OHILAB_ETHERNET_SOCKET_TEST_LWIPOPTS_H
+
+#define NO_SYS                            1
+#define SYS_LIGHTWEIGHT_PROT              0
+#define LWIP_NETCONN                      0
+#define LWIP_SOCKET                       0
+
+#define LWIP_IPV4                         1
+#define LWIP_IPV6                         0
+#define LWIP_ARP                          0
+#define LWIP_ETHERNET                     0
+#define LWIP_HAVE_LOOPIF                  1
+#define LWIP_NETIF_LOOPBACK               1
+
+#define MEM_ALIGNMENT                     8
+#define MEM_SIZE                          (256 * 1024)
+#define MEMP_NUM_TCP_PCB                  8
+#define PBUF_POOL_SIZE                    64
+
+#define LWIP_TCP                          1
+#define LWIP_TCP_KEEPALIVE                1
+#define TCP_MSS                           1460
+#define TCP_WND                           (4 * TCP_MSS)
+#define TCP_SND_BUF                       (4 * TCP_MSS)
+
+#define LWIP_ALTCP                        1
+#define LWIP_ALTCP_TLS                    1
+#define LWIP_ALTCP_TLS_MBEDTLS            1
+#define ALTCP_MBEDTLS_USE_SESSION_CACHE   1
+#define ALTCP_MBEDTLS_SESSION_CACHE_SIZE  4
+#define ALTCP_MBEDTLS_USE_SESSION_TICKETS 0
+
+#define LWIP_STATS                        0
+
+#endif // __OHILAB_ETHERNET_SOCKET_TEST_LWIPOPTS_H
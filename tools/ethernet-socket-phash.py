@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+#
+# Ethernet Client/Server Socket with libohiboard
+# Copyright (C) 2017-2018 A. C. Open Hardware Ideas Lab
+#
+# Generator of the perfect hash tables of ethernet-socket-dispatcher.h.
+# It searches a seed that gives a different slot to every command, with
+# the same hash of EthernetSocketDispatcher_hash(), and writes a header
+# with the handler prototypes, <prefix>_SEED, <prefix>_MASK and
+# <prefix>_table.
+#
+# Usage: ethernet-socket-phash.py [-o file.h] prefix command=handler ...
+#
+# Command names can use C escapes for binary commands, for example
+# '\x01=Binary_read'.
+#
+# Released under the MIT license, see LICENSE.
+
+import argparse
+import codecs
+import sys
+
+MAX_SEEDS = 1 << 20
+
+
+def fnv1a(key, seed):
+    value = (2166136261 ^ seed) & 0xFFFFFFFF
+    for byte in key:
+        value ^= byte
+        value = (value * 16777619) & 0xFFFFFFFF
+    return value ^ (value >> 16)
+
+
+def search(keys):
+    size = 1
+    while size < len(keys):
+        size <<= 1
+    while True:
+        for seed in range(MAX_SEEDS):
+            slots = set(fnv1a(key, seed) & (size - 1) for key in keys)
+            if len(slots) == len(keys):
+                return seed, size
+        size <<= 1
+
+
+def c_string(key):
+    text = ""
+    for byte in key:
+        if 32 <= byte < 127 and chr(byte) not in "\"\\?":
+            text += chr(byte)
+        else:
+            text += "\\%03o" % byte
+    return '"%s"' % text
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a dispatcher perfect hash table")
+    parser.add_argument("-o", "--output", help="output file, default stdout")
+    parser.add_argument("prefix", help="prefix of the generated names")
+    parser.add_argument("commands", nargs="+", metavar="command=handler")
+    args = parser.parse_args()
+
+    commands = []
+    for item in args.commands:
+        name, _, handler = item.rpartition("=")
+        if not name or not handler:
+            parser.error("wrong command '%s'" % item)
+        key = codecs.decode(name, "unicode_escape").encode("latin-1")
+        commands.append((key, handler))
+
+    keys = [key for key, _ in commands]
+    if len(set(keys)) != len(keys):
+        parser.error("duplicated command")
+
+    seed, size = search(keys)
+
+    lines = []
+    lines.append("/* Generated by tools/ethernet-socket-phash.py, don't edit! */")
+    lines.append("")
+    for handler in sorted(set(handler for _, handler in commands)):
+        lines.append("void %s (const uint8_t* args, uint16_t length, "
+                     "EthernetSocketDispatcher_Reply* reply);" % handler)
+    lines.append("")
+    lines.append("#define %s_SEED 0x%08Xu" % (args.prefix, seed))
+    lines.append("#define %s_MASK %d" % (args.prefix, size - 1))
+    lines.append("")
+    lines.append("static const EthernetSocketDispatcher_Command %s_table[%d] =" % (args.prefix, size))
+    lines.append("{")
+    for key, handler in sorted(commands, key=lambda c: fnv1a(c[0], seed) & (size - 1)):
+        lines.append("    [%d] = { %s, %d, %s }," % (fnv1a(key, seed) & (size - 1),
+                                                   c_string(key), len(key), handler))
+    lines.append("};")
+
+    text = "\n".join(lines) + "\n"
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
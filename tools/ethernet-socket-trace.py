@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+#
+# Ethernet Client/Server Socket with libohiboard
+# Copyright (C) 2017-2018 A. C. Open Hardware Ideas Lab
+#
+# Decoder of the trace written by EthernetSocket_traceDump(), see
+# ethernet-socket-trace.h for the format. It prints the records and the
+# latency distributions of every connection, in ticks:
+#
+#   wait     first application read after a receive from lwIP
+#   read     receive from lwIP until all its bytes are read
+#   handler  last read until the next application write
+#   output   application write until tcp_output of its bytes
+#
+# Usage: ethernet-socket-trace.py [--records] trace.bin
+#
+# Released under the MIT license, see LICENSE.
+
+import argparse
+import struct
+import sys
+from collections import OrderedDict, deque
+
+MAGIC = b"ESTR"
+VERSION = 1
+HEADER = struct.Struct("<4sBBHI")
+
+EVENTS = {
+    1: "ACCEPT",
+    2: "REJECT",
+    3: "RECEIVE",
+    4: "READ",
+    5: "WRITE",
+    6: "OUTPUT",
+    7: "ERROR",
+    8: "CLOSE",
+}
+
+METRICS = ("wait", "read", "handler", "output")
+
+
+def parse(data):
+    magic, version, size, count, total = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not an ethernet-socket trace")
+    records = []
+    offset = HEADER.size
+    for _ in range(count):
+        tick, value, event, server, client = struct.unpack_from("<IiBBB", data, offset)
+        records.append((tick, EVENTS.get(event, str(event)), server, client, value))
+        offset += size
+    return records, total
+
+
+class Connection:
+    def __init__(self, name):
+        self.name = name
+        self.received = deque()   # [tick, bytes not read, already touched]
+        self.written = deque()    # [tick, bytes not sent]
+        self.lastRead = None
+        self.samples = {metric: [] for metric in METRICS}
+
+    def receive(self, tick, length):
+        self.received.append([tick, length, False])
+
+    def read(self, tick, length):
+        self.lastRead = tick
+        while length > 0 and self.received:
+            chunk = self.received[0]
+            if not chunk[2]:
+                self.samples["wait"].append(tick - chunk[0])
+                chunk[2] = True
+            used = min(length, chunk[1])
+            chunk[1] -= used
+            length -= used
+            if chunk[1] == 0:
+                self.samples["read"].append(tick - chunk[0])
+                self.received.popleft()
+
+    def write(self, tick, length):
+        if self.lastRead is not None:
+            self.samples["handler"].append(tick - self.lastRead)
+            self.lastRead = None
+        self.written.append([tick, length])
+
+    def output(self, tick, length):
+        while length > 0 and self.written:
+            chunk = self.written[0]
+            used = min(length, chunk[1])
+            chunk[1] -= used
+            length -= used
+            if chunk[1] == 0:
+                self.samples["output"].append(tick - chunk[0])
+                self.written.popleft()
+
+
+def percentile(values, fraction):
+    index = min(len(values) - 1, int(round(fraction * (len(values) - 1))))
+    return values[index]
+
+
+def report(name, samples):
+    print(name)
+    for metric in METRICS:
+        values = sorted(samples[metric])
+        if not values:
+            continue
+        print("  %-8s n=%-6d min=%-6d p50=%-6d p90=%-6d p99=%-6d max=%d" % (
+            metric, len(values), values[0], percentile(values, 0.5),
+            percentile(values, 0.9), percentile(values, 0.99), values[-1]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode an ethernet-socket trace")
+    parser.add_argument("--records", action="store_true", help="print every record")
+    parser.add_argument("trace", help="file written with EthernetSocket_traceDump()")
+    args = parser.parse_args()
+
+    with open(args.trace, "rb") as f:
+        records, total = parse(f.read())
+
+    if total > len(records):
+        print("%d oldest records lost, the ring is too small" % (total - len(records)))
+
+    open_connections = {}
+    connections = OrderedDict()
+    sequence = 0
+
+    for tick, event, server, client, value in records:
+        if args.records:
+            print("%10d %-8s server %-3d client %-3d %d" % (tick, event, server, client, value))
+
+        key = (server, client)
+        if event == "ACCEPT" or key not in open_connections:
+            sequence += 1
+            name = "server %d client %d #%d" % (server, client, sequence)
+            open_connections[key] = connections[name] = Connection(name)
+        connection = open_connections[key]
+
+        if event == "RECEIVE":
+            connection.receive(tick, value)
+        elif event == "READ":
+            connection.read(tick, value)
+        elif event == "WRITE":
+            connection.write(tick, value)
+        elif event == "OUTPUT":
+            connection.output(tick, value)
+        elif event == "CLOSE":
+            del open_connections[key]
+
+    overall = {metric: [] for metric in METRICS}
+    for connection in connections.values():
+        report(connection.name, connection.samples)
+        for metric in METRICS:
+            overall[metric] += connection.samples[metric]
+    report("all connections", overall)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())